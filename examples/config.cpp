@@ -5,6 +5,12 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+struct Tunables {
+  int32_t sampleRate;
+  float gain;
+  bool isFilterEnabled;
+};
+
 extern "C" void app_main() {
   namespace es = essentials;
   es::Esp32Storage configStorage{"config"};
@@ -13,6 +19,11 @@ extern "C" void app_main() {
   auto ssidConfig = config.get<std::string>("ssid");
   auto integerConfig = config.get<int>("integer");
 
+  // reaction is called whenever value is changed by operator=
+  auto ssidSubscription =
+    config.subscribe("ssid", [](const es::StorageKey& key) { printf("%s was changed\n", key.c_str()); });
+  uint32_t configVersion = config.version();
+
   // operator* loads value from storage and returns it
   // similar usage as std::optional
   if (ssidConfig->empty()) {
@@ -30,6 +41,26 @@ extern "C" void app_main() {
   // end of calculation
   integerConfig = integer; // save to storage
 
+  if (config.hasChangedSince(configVersion)) {
+    printf("Config was changed, version is %u\n", config.version());
+  }
+
+  // cached config loads value from storage only on first access, operator= updates the cache
+  es::Config cachedConfig{configStorage, es::Config::Mode::Cached};
+  auto cachedInteger = cachedConfig.get<int>("integer");
+  for (int i = 0; i < 1000; i++) {
+    integer = *cachedInteger; // load from cache
+  }
+  es::Config::CacheStats stats = cachedConfig.cacheStats();
+  printf("Cache hits: %u, misses: %u\n", stats.hits, stats.misses);
+
+  // whole struct is stored in one blob and loaded with a single storage read
+  auto tunables = config.getStruct<Tunables>("tunables", 1, Tunables{100, 1.5f, true});
+  printf("Sample rate is %d, gain is %f\n", tunables->sampleRate, tunables->gain);
+  Tunables newTunables = *tunables;
+  newTunables.gain *= 2.0f;
+  tunables = newTunables; // save whole struct to storage
+
   vTaskDelay(pdMS_TO_TICKS(5000));
   esp_restart();
 }
@@ -0,0 +1,50 @@
+#include "esp_system.h"
+#include "essentials/config.hpp"
+#include "essentials/esp32_storage.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <atomic>
+
+namespace es = essentials;
+
+std::atomic<uint32_t> readCount{0};
+
+extern "C" void app_main() {
+  es::Esp32Storage storage{"stress"};
+  // concurrent config can be read by multiple tasks while other tasks write into it
+  static es::Config config{storage, es::Config::Mode::Concurrent};
+  static auto counter = config.get<int>("counter");
+
+  for (int core = 0; core < 2; core++) {
+    xTaskCreatePinnedToCore(
+      [](void*) {
+        int lastValue = 0;
+        while (true) {
+          int value = *counter; // wait-free read from cache
+          if (value < lastValue) printf("counter went backwards: %d < %d\n", value, lastValue);
+          lastValue = value;
+          readCount++;
+        }
+      },
+      "reader",
+      4 * 1024,
+      nullptr,
+      tskIDLE_PRIORITY + 1,
+      nullptr,
+      core);
+  }
+
+  auto writerCounter = config.get<int>("counter");
+  writerCounter = 0;
+  for (int i = 1; i <= 100; i++) {
+    writerCounter = i; // writes are serialized into storage and cache
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+
+  es::Config::CacheStats stats = config.cacheStats();
+  printf("reads: %u, cache hits: %u, misses: %u\n", readCount.load(), stats.hits, stats.misses);
+
+  vTaskDelay(pdMS_TO_TICKS(5000));
+  esp_restart();
+}
@@ -0,0 +1,113 @@
+#include "essentials/config.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace es = essentials;
+
+constexpr int READERS = 4;
+constexpr int WRITES = 20000;
+
+/**
+ * @brief Storage in RAM, thus the stress test runs without flash
+ */
+struct MemoryStorage : es::PersistentStorage {
+  mutable std::mutex mutex{};
+  std::map<std::string, std::vector<uint8_t>, std::less<>> values{};
+
+  int size(const es::StorageKey& key) const override {
+    std::lock_guard lock{mutex};
+    auto it = values.find(key.view());
+    return it == values.end() ? -1 : int(it->second.size());
+  }
+
+  std::vector<uint8_t> read(const es::StorageKey& key, int size) const override {
+    std::lock_guard lock{mutex};
+    auto it = values.find(key.view());
+    if (it == values.end()) return {};
+    std::vector<uint8_t> data = it->second;
+    data.resize(size);
+    return data;
+  }
+
+  void write(const es::StorageKey& key, es::Span<uint8_t> data) override {
+    std::lock_guard lock{mutex};
+    values[std::string(key.view())].assign(data.data, data.data + data.size);
+  }
+
+  void clear() override {
+    std::lock_guard lock{mutex};
+    values.clear();
+  }
+};
+
+/**
+ * @brief Both fields are written together, reader which sees them differ read a torn struct
+ */
+struct Pair {
+  int32_t value;
+  int32_t negated;
+};
+
+extern "C" void app_main() {
+  MemoryStorage storage{};
+  // concurrent config can be read by multiple threads while other threads write into it
+  es::Config config{storage, es::Config::Mode::Concurrent};
+  auto counter = config.get<int>("counter");
+  auto pair = config.getStruct<Pair>("pair", 1);
+
+  std::atomic<bool> isStopping = false;
+  std::atomic<uint32_t> reads = 0;
+  std::atomic<uint32_t> backwards = 0;
+  std::atomic<uint32_t> torn = 0;
+  std::vector<std::thread> readers{};
+  for (int i = 0; i < READERS; i++) {
+    readers.emplace_back([&]() {
+      int lastValue = 0;
+      while (!isStopping) {
+        const int value = *counter; // wait-free read from cache
+        if (value < lastValue) backwards++;
+        lastValue = value;
+
+        const Pair readPair = *pair;
+        if (readPair.value != -readPair.negated) torn++;
+        reads++;
+      }
+    });
+  }
+
+  std::atomic<uint32_t> notifications = 0;
+  std::thread counterWriter{[&]() {
+    for (int i = 1; i <= WRITES; i++) {
+      counter = i; // writes are serialized into storage and cache
+    }
+  }};
+  std::thread pairWriter{[&]() {
+    for (int i = 1; i <= WRITES; i++) {
+      // subscriptions come and go while values change
+      auto subscription = config.subscribe("pair", [&notifications](const es::StorageKey&) { notifications++; });
+      pair = Pair{i, -i};
+      if (i % 100 == 0) pair.reload();
+    }
+  }};
+  counterWriter.join();
+  pairWriter.join();
+  isStopping = true;
+  for (auto& reader : readers) reader.join();
+
+  es::Config::CacheStats stats = config.cacheStats();
+  printf("reads: %u, counter went backwards %u times, torn structs: %u, notifications: %u, version: %u, cache hits: "
+         "%u, misses: %u\n",
+    reads.load(),
+    backwards.load(),
+    torn.load(),
+    notifications.load(),
+    config.version(),
+    stats.hits,
+    stats.misses);
+}
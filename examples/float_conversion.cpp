@@ -0,0 +1,131 @@
+#include "essentials/float_conversion.hpp"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace es = essentials;
+
+constexpr int CONVERSIONS = 20000;
+
+/**
+ * @brief Previous conversion of Mqtt used for comparison
+ */
+std::string previousFormat(double value) {
+  return std::to_string(value);
+}
+
+double previousParse(const std::string& text) {
+  return std::stod(text);
+}
+
+template<typename T, typename Bits>
+bool isSame(T left, T right) {
+  Bits leftBits;
+  Bits rightBits;
+  std::memcpy(&leftBits, &left, sizeof(left));
+  std::memcpy(&rightBits, &right, sizeof(right));
+  return leftBits == rightBits;
+}
+
+/**
+ * @brief Check that formatted numbers are parsed back into the same numbers, previous format is checked for
+ * comparison
+ */
+template<typename T, typename Bits>
+void checkRoundTrip(const char* name) {
+  std::mt19937 random{42};
+  int failed = 0;
+  int previousFailed = 0;
+  int checked = 0;
+  for (int i = 0; i < CONVERSIONS; i++) {
+    // NOTE random bits cover whole range including subnormal numbers
+    Bits bits = 0;
+    for (std::size_t byte = 0; byte < sizeof(Bits); byte += 4) {
+      bits = (bits << 16 << 16) | random();
+    }
+    T value;
+    std::memcpy(&value, &bits, sizeof(value));
+    if (!std::isfinite(value)) continue;
+    checked++;
+
+    std::array<char, es::MAX_FLOAT_CHARS> buffer;
+    const std::size_t size = es::formatFloat(value, es::MutableSpan<char>{buffer.data(), buffer.size()});
+    T parsed{};
+    const bool isParsed = size > 0 && es::parseFloat(std::string_view{buffer.data(), size}, parsed);
+    if (!isParsed || !isSame<T, Bits>(value, parsed)) failed++;
+
+    if (!isSame<T, Bits>(value, T(std::strtod(previousFormat(value).c_str(), nullptr)))) previousFailed++;
+  }
+  printf("%s round trip: %d of %d failed, previous format %d failed\n", name, failed, checked, previousFailed);
+}
+
+void benchmark() {
+  std::mt19937 random{42};
+  std::uniform_real_distribution<double> distribution{-1000.0, 1000.0};
+  std::vector<double> values;
+  for (int i = 0; i < CONVERSIONS; i++) {
+    values.push_back(distribution(random));
+  }
+
+  std::array<char, es::MAX_FLOAT_CHARS> buffer;
+  std::size_t formattedSize = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (double value : values) {
+    formattedSize += es::formatFloat(value, es::MutableSpan<char>{buffer.data(), buffer.size()});
+  }
+  auto formatDuration = std::chrono::steady_clock::now() - start;
+
+  std::size_t previousSize = 0;
+  start = std::chrono::steady_clock::now();
+  for (double value : values) {
+    previousSize += previousFormat(value).size();
+  }
+  auto previousFormatDuration = std::chrono::steady_clock::now() - start;
+
+  std::vector<std::string> texts;
+  for (double value : values) {
+    const std::size_t size = es::formatFloat(value, es::MutableSpan<char>{buffer.data(), buffer.size()});
+    texts.emplace_back(buffer.data(), size);
+  }
+
+  double sum = 0;
+  start = std::chrono::steady_clock::now();
+  for (const std::string& text : texts) {
+    double value = 0;
+    es::parseFloat(text, value);
+    sum += value;
+  }
+  auto parseDuration = std::chrono::steady_clock::now() - start;
+
+  double previousSum = 0;
+  start = std::chrono::steady_clock::now();
+  for (const std::string& text : texts) {
+    previousSum += previousParse(text);
+  }
+  auto previousParseDuration = std::chrono::steady_clock::now() - start;
+
+  auto perConversion = [](auto duration) {
+    return std::chrono::duration<double, std::micro>(duration).count() / CONVERSIONS;
+  };
+  printf("format: %.3f us (%.1f chars), previous %.3f us (%.1f chars)\n",
+    perConversion(formatDuration),
+    double(formattedSize) / CONVERSIONS,
+    perConversion(previousFormatDuration),
+    double(previousSize) / CONVERSIONS);
+  printf("parse: %.3f us, previous %.3f us, sums %s\n",
+    perConversion(parseDuration),
+    perConversion(previousParseDuration),
+    sum == previousSum ? "match" : "differ");
+}
+
+extern "C" void app_main() {
+  checkRoundTrip<double, uint64_t>("double");
+  checkRoundTrip<float, uint32_t>("float");
+  benchmark();
+}
@@ -0,0 +1,71 @@
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "essentials/esp32_partition.hpp"
+#include "essentials/esp32_storage.hpp"
+#include "essentials/log_storage.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <array>
+#include <string>
+
+namespace es = essentials;
+
+constexpr int WRITES = 500;
+constexpr int KEYS = 20;
+
+struct Result {
+  int64_t writeUs;
+  int64_t readUs;
+};
+
+Result measure(es::PersistentStorage& storage) {
+  std::array<uint8_t, 32> data{};
+  std::array<uint8_t, 32> buffer{};
+
+  int64_t start = esp_timer_get_time();
+  for (int i = 0; i < WRITES; i++) {
+    data[0] = uint8_t(i);
+    std::string key = "key" + std::to_string(i % KEYS);
+    storage.write(es::StorageKey{key}, es::Span<uint8_t>{data.data(), data.size()});
+  }
+  int64_t writeUs = esp_timer_get_time() - start;
+
+  start = esp_timer_get_time();
+  for (int i = 0; i < WRITES; i++) {
+    std::string key = "key" + std::to_string(i % KEYS);
+    storage.readInto(es::StorageKey{key}, es::MutableSpan<uint8_t>{buffer.data(), buffer.size()});
+  }
+  int64_t readUs = esp_timer_get_time() - start;
+
+  return Result{writeUs, readUs};
+}
+
+extern "C" void app_main() {
+  // partitions.csv needs data partition for log storage:
+  // logstore, data, 0x40, , 0x10000,
+  es::Esp32Partition partition{"logstore"};
+  es::LogStorage logStorage{partition};
+  logStorage.clear();
+
+  es::Esp32Storage nvsStorage{"benchmark"};
+  nvsStorage.clear();
+
+  Result log = measure(logStorage);
+  es::LogStorage::Stats stats = logStorage.stats();
+  printf("log storage: write %lld us/op, read %lld us/op, %u bytes written, %u sector erases, %u compactions\n",
+    log.writeUs / WRITES,
+    log.readUs / WRITES,
+    stats.bytesWritten,
+    stats.sectorErases,
+    stats.compactions);
+
+  Result nvs = measure(nvsStorage);
+  printf("nvs storage: write %lld us/op, read %lld us/op, %u commits\n",
+    nvs.writeUs / WRITES,
+    nvs.readUs / WRITES,
+    nvsStorage.commitCount());
+
+  vTaskDelay(pdMS_TO_TICKS(5000));
+  esp_restart();
+}
@@ -4,6 +4,7 @@
 #include "essentials/device_info.hpp"
 #include "essentials/esp32_storage.hpp"
 #include "essentials/settings_server.hpp"
+#include "essentials/telemetry.hpp"
 #include "essentials/wifi.hpp"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -77,32 +78,44 @@ void exampleApp() {
     std::chrono::seconds{30},
     lastWill,
     []() { printf("MQTT is connected!\n"); },
-    []() { printf("MQTT is disconnected!\n"); }};
-
-  // task which publishes device info every second
-  xTaskCreate(
-    +[](void* arg) {
-      es::Mqtt& mqtt = *reinterpret_cast<es::Mqtt*>(arg);
-      while (true) {
-        mqtt.publish("info/freeHeap", deviceInfo.freeHeap(), es::Mqtt::Qos::Qos0, false);
-        mqtt.publish("info/totalHeap", deviceInfo.totalHeap(), es::Mqtt::Qos::Qos0, false);
-        mqtt.publish("info/uptime", deviceInfo.uptime(), es::Mqtt::Qos::Qos0, false);
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
-      }
-    },
-    "device_info",
-    4 * 1024,
-    &mqtt,
-    configMAX_PRIORITIES,
-    nullptr);
+    []() { printf("MQTT is disconnected!\n"); },
+    1024,
+    true}; // broker keeps subscriptions while disconnected, thus reconnect doesn't resubscribe
+
+  // subscriptions which have to be sent after connect are sent in batches of 8 every 50 ms
+  mqtt.setResubscribePacing(8, std::chrono::milliseconds{50});
+
+  // messages published while disconnected are kept in 8 kB and sent after reconnect, only the newest value of a
+  // topic is kept
+  mqtt.setOutboundQueue(8 * 1024, es::OutboundQueue::DropPolicy::Oldest, true);
+
+  // reactions run on a worker thread, so they don't block MQTT client's task
+  mqtt.setDispatchWorkers(1, 8);
+
+  // device info is sampled every second and published as one JSON message to 'info' topic, each value is published
+  // also to its own topic (eg. 'info/freeHeap')
+  es::Telemetry telemetry{mqtt, "info", std::chrono::seconds{1}, es::Telemetry::Format::Json, 512, true};
+  telemetry.sample("freeHeap", []() { return deviceInfo.freeHeap(); });
+  telemetry.sample("totalHeap", []() { return deviceInfo.totalHeap(); });
+  telemetry.sample("uptime", []() { return deviceInfo.uptime(); });
 
+  // messages bigger than MQTT buffer are reassembled in buffers from the pool, pool must outlive subscriptions
+  es::BufferPool messagePool{2, 4 * 1024};
   std::vector<std::unique_ptr<es::Mqtt::Subscription>> subs;
 
+  subs.emplace_back(
+    // reassembled subscription
+    mqtt.subscribe("document", es::Mqtt::Qos::Qos0, messagePool, 4 * 1024, [](std::string_view data) {
+      printf("got document of size %u\n", data.size());
+    }));
+
   subs.emplace_back(mqtt.subscribe("ping", es::Mqtt::Qos::Qos0, [&mqtt](std::string_view data) {
     std::string text = std::string(data);
     printf("got ping: %s\n", text.c_str());
     mqtt.publish("pong", "Pinging back :)", es::Mqtt::Qos::Qos0, false);
   }));
+  // ping is answered before other waiting messages
+  subs.back()->priority = es::Mqtt::Priority::High;
 
   subs.emplace_back(
     // lambda subscription
@@ -132,6 +145,16 @@ void exampleApp() {
       mqtt.publish("test/integer", 42, es::Mqtt::Qos::Qos0, false);
       mqtt.publish("test/double", 42.4242, es::Mqtt::Qos::Qos0, false);
       mqtt.publish("test/bool", true, es::Mqtt::Qos::Qos0, false);
+
+      auto outbound = mqtt.outboundStats();
+      printf("outbound queue: depth %u, dropped %u, sent %u\n", outbound.depth, outbound.dropped, outbound.sent);
+      auto dispatch = mqtt.dispatchStats();
+      printf("dispatch: depth %u, dropped %u, dispatched %u\n", dispatch.depth, dispatch.dropped, dispatch.dispatched);
+      auto reconnect = mqtt.reconnectStats();
+      printf("reconnect: connects %u, resumed sessions %u, subscriptions ready in %lld ms\n",
+        reconnect.connects,
+        reconnect.resumedSessions,
+        reconnect.timeToReady.count() / 1000);
     }
 
     vTaskDelay(1000 / portTICK_PERIOD_MS);
@@ -0,0 +1,82 @@
+#include "essentials/mqtt.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+namespace es = essentials;
+
+constexpr int FORMATS = 1000;
+
+std::atomic<uint32_t> allocationCount{0};
+
+void* operator new(std::size_t size) {
+  allocationCount++;
+  void* memory = std::malloc(size);
+  if (!memory) throw std::bad_alloc();
+  return memory;
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+struct Sample {
+  float temperature;
+  int32_t humidity;
+  bool isCharging;
+};
+
+template<>
+struct es::Fields<Sample> {
+  static constexpr auto value = std::make_tuple(field("t", &Sample::temperature),
+    field("h", &Sample::humidity),
+    field("c", &Sample::isCharging));
+};
+
+/**
+ * @brief Payload copied as MQTT client copies it into its outbox
+ */
+std::array<char, 256> outbox{};
+std::size_t outboxSize = 0;
+
+void publish(std::string_view payload) {
+  outboxSize = std::min(payload.size(), outbox.size());
+  std::memcpy(outbox.data(), payload.data(), outboxSize);
+}
+
+template<typename Format>
+void measure(const char* name, Format&& format) {
+  uint32_t allocationsBefore = allocationCount.load();
+  for (int i = 0; i < FORMATS; i++) {
+    format(i);
+  }
+  printf("%s: %u allocations per %d publishes, last payload %u bytes\n",
+    name,
+    allocationCount.load() - allocationsBefore,
+    FORMATS,
+    unsigned(outboxSize));
+}
+
+extern "C" void app_main() {
+  // payloads of typed publish, esp-mqtt isn't needed for them thus this runs also on a host
+  measure("integer", [](int i) { es::Mqtt::format(i, publish); });
+  measure("float", [](int i) { es::Mqtt::format(20.0f + i / 100.0f, publish); });
+  measure("double", [](int i) { es::Mqtt::format(i / 3.0, publish); });
+  measure("bool", [](int i) { es::Mqtt::format(i % 2 == 0, publish); });
+  measure("described struct", [](int i) { es::Mqtt::format(Sample{i / 10.0f, i % 100, i % 2 == 0}, publish); });
+  // previous typed publish prefixed the topic and formatted the value into strings on every publish
+  const std::string prefix = "esp32/allocations";
+  measure("previous string topic and std::to_string", [&prefix](int i) {
+    const std::string topic = prefix + "/" + "temperature";
+    publish(topic);
+    publish(std::to_string(20.0f + i / 100.0f));
+  });
+}
@@ -0,0 +1,57 @@
+#include "esp_system.h"
+#include "essentials/config.hpp"
+#include "essentials/esp32_partition.hpp"
+#include "essentials/esp32_storage.hpp"
+#include "essentials/mqtt.hpp"
+#include "essentials/payload_sink.hpp"
+#include "essentials/wifi.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <string>
+
+namespace es = essentials;
+
+extern "C" void app_main() {
+  es::Esp32Storage configStorage{"config"};
+  es::Config config{configStorage};
+  es::Wifi wifi;
+  wifi.connect(*config.get<std::string>("ssid"), *config.get<std::string>("wifiPass"));
+  vTaskDelay(pdMS_TO_TICKS(5000));
+
+  // NOTE "assets" is a data partition of partitions.csv (eg. "assets, data, spiffs, , 1M,")
+  es::Esp32Partition assetsPartition{"assets"};
+  es::PartitionSink assetsSink{assetsPartition};
+  es::Esp32Storage certStorage{"certs"};
+  es::StorageSink certSink{certStorage, "bundle"};
+
+  if (std::optional<std::size_t> size = assetsSink.verify()) printf("Assets of %u bytes are stored\n", *size);
+  if (std::optional<std::size_t> size = certSink.verify()) printf("Certificate bundle of %u bytes is stored\n", *size);
+
+  // NOTE messages bigger than MQTT buffer arrive in fragments which are written straight into the sink
+  es::Mqtt mqtt{{"mqtt://test.mosquitto.org", {}, {}, {}}, "esp32/streaming"};
+  auto assetsSubscription = mqtt.subscribe(
+    "assets", es::Mqtt::Qos::Qos1, assetsSink, es::Mqtt::Integrity::Crc32, [&assetsSink](bool isCommitted) {
+      if (!isCommitted) {
+        printf("Assets were dropped\n");
+        return;
+      }
+      printf("Assets of %u bytes were committed\n", *assetsSink.verify());
+    });
+  auto certSubscription = mqtt.subscribe(
+    "cert", es::Mqtt::Qos::Qos1, certSink, es::Mqtt::Integrity::Length, [&certSink](bool isCommitted) {
+      if (!isCommitted) {
+        printf("Certificate bundle was dropped, previous one is kept\n");
+        return;
+      }
+      std::size_t lines = 0;
+      certSink.read([&lines](es::Span<uint8_t> chunk) {
+        for (std::size_t i = 0; i < chunk.size; i++) lines += chunk.data[i] == '\n';
+      });
+      printf("Certificate bundle of %u lines was committed\n", lines);
+    });
+
+  while (true) {
+    vTaskDelay(pdMS_TO_TICKS(1000));
+  }
+}
@@ -0,0 +1,79 @@
+#include "esp_system.h"
+#include "essentials/config.hpp"
+#include "essentials/esp32_storage.hpp"
+#include "essentials/mqtt.hpp"
+#include "essentials/wifi.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace es = essentials;
+
+constexpr int PUBLISHES = 1000;
+
+std::atomic<uint32_t> allocationCount{0};
+
+void* operator new(std::size_t size) {
+  allocationCount++;
+  void* memory = std::malloc(size);
+  if (!memory) throw std::bad_alloc();
+  return memory;
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+template<typename Publish>
+void measure(const char* name, Publish&& publish) {
+  uint32_t allocationsBefore = allocationCount.load();
+  for (int i = 0; i < PUBLISHES; i++) {
+    publish(i);
+  }
+  printf("%s: %u allocations per %d publishes\n", name, allocationCount.load() - allocationsBefore, PUBLISHES);
+}
+
+extern "C" void app_main() {
+  // NOTE WiFi is optional, QoS 0 messages are dropped by MQTT client without connection
+  es::Esp32Storage configStorage{"config"};
+  es::Config config{configStorage};
+  es::Wifi wifi;
+  wifi.connect(*config.get<std::string>("ssid"), *config.get<std::string>("wifiPass"));
+  vTaskDelay(pdMS_TO_TICKS(5000));
+
+  es::Mqtt mqtt{{"mqtt://test.mosquitto.org", {}, {}, {}}, "esp32/allocations"};
+  vTaskDelay(pdMS_TO_TICKS(5000));
+  printf("MQTT is %s\n", mqtt.isConnected() ? "connected" : "disconnected");
+
+  const es::Mqtt::Topic counterTopic = mqtt.topic("counter");
+  const es::Mqtt::Topic temperatureTopic = mqtt.topic("temperature");
+
+  measure("string topic, integer", [&mqtt](int i) { mqtt.publish("counter", i, es::Mqtt::Qos::Qos0, false); });
+  measure("topic handle, integer", [&](int i) { mqtt.publish(counterTopic, i, es::Mqtt::Qos::Qos0, false); });
+  measure("topic handle, float", [&](int i) {
+    mqtt.publish(temperatureTopic, 20.0f + i / 100.0f, es::Mqtt::Qos::Qos0, false);
+  });
+  measure("topic handle, bool", [&](int i) { mqtt.publish(counterTopic, i % 2 == 0, es::Mqtt::Qos::Qos0, false); });
+
+  // subscriptions come from a pool and their reactions are stored inline, after the topic is known to subscribers
+  // table, subscribing and unsubscribing doesn't allocate
+  es::Mqtt::reserveSubscriptions(4);
+  int counter = 0;
+  auto counterSubscription = mqtt.subscribe("counter", es::Mqtt::Qos::Qos0, counter);
+  uint32_t allocationsBefore = allocationCount.load();
+  for (int i = 0; i < PUBLISHES; i++) {
+    auto subscription = mqtt.subscribe<int>(
+      "counter", es::Mqtt::Qos::Qos0, [&counter](std::optional<int> value) { counter = value.value_or(0); });
+  }
+  printf("subscribe: %u allocations per %d subscriptions\n", allocationCount.load() - allocationsBefore, PUBLISHES);
+
+  vTaskDelay(pdMS_TO_TICKS(5000));
+  esp_restart();
+}
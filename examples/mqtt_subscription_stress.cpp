@@ -0,0 +1,144 @@
+#include "essentials/left_right.hpp"
+#include "essentials/topic_trie.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace es = essentials;
+
+constexpr int WRITERS = 2;
+constexpr int CHANGES_PER_WRITER = 2000;
+constexpr std::chrono::microseconds SLOW_DELIVERY{100};
+
+/**
+ * @brief Subscriber of the table, it is freed right after it is erased thus reaching it later is use after free
+ */
+struct Subscriber {
+  std::string topic;
+  std::atomic<bool> isErased = false;
+  std::atomic<uint32_t> deliveries = 0;
+};
+
+/**
+ * @brief Subscribers table of the previous Mqtt, delivery waits while the table is modified
+ */
+struct LockedTable {
+  std::mutex mutex{};
+  es::TopicTrie<Subscriber*> trie{};
+
+  template<typename Reaction>
+  void match(std::string_view topic, Reaction&& reaction) {
+    std::lock_guard lock{mutex};
+    trie.match(topic, reaction);
+  }
+
+  void insert(Subscriber* subscriber) {
+    std::lock_guard lock{mutex};
+    trie.insert(subscriber->topic, subscriber);
+  }
+
+  void erase(Subscriber* subscriber) {
+    std::lock_guard lock{mutex};
+    trie.erase(subscriber->topic, subscriber);
+  }
+};
+
+/**
+ * @brief Subscribers table of Mqtt, delivery reads without waiting and changes wait for deliveries instead
+ */
+struct LeftRightTable {
+  es::LeftRight<es::TopicTrie<Subscriber*>> trie{};
+
+  template<typename Reaction>
+  void match(std::string_view topic, Reaction&& reaction) {
+    trie.read([&](const es::TopicTrie<Subscriber*>& instance) { instance.match(topic, reaction); });
+  }
+
+  void insert(Subscriber* subscriber) {
+    trie.modify([subscriber](es::TopicTrie<Subscriber*>& instance) { instance.insert(subscriber->topic, subscriber); });
+  }
+
+  void erase(Subscriber* subscriber) {
+    trie.modify([subscriber](es::TopicTrie<Subscriber*>& instance) { instance.erase(subscriber->topic, subscriber); });
+  }
+};
+
+/**
+ * @brief Deliver messages on one thread while other threads subscribe and unsubscribe, check that erased subscriber
+ * is never reached and measure how long deliveries take
+ */
+template<typename Table>
+void stress(const char* name) {
+  Table table{};
+  std::vector<std::unique_ptr<Subscriber>> permanent{};
+  for (int i = 0; i < 20; i++) {
+    permanent.push_back(std::make_unique<Subscriber>());
+    permanent.back()->topic = "home/room" + std::to_string(i) + "/+";
+    table.insert(permanent.back().get());
+  }
+
+  std::atomic<bool> isStopping = false;
+  std::atomic<uint32_t> erasedReached = 0;
+  uint32_t delivered = 0;
+  uint32_t slowDelivered = 0;
+  std::chrono::nanoseconds totalDuration{};
+  std::chrono::nanoseconds maxDuration{};
+  std::thread delivery{[&]() {
+    const std::string topics[] = {"home/room1/temperature", "home/room7/humidity", "home/room1/light"};
+    while (!isStopping) {
+      for (const std::string& topic : topics) {
+        const auto start = std::chrono::steady_clock::now();
+        table.match(topic, [&erasedReached](Subscriber* subscriber) {
+          if (subscriber->isErased) erasedReached++;
+          subscriber->deliveries++;
+        });
+        const auto duration = std::chrono::steady_clock::now() - start;
+        totalDuration += duration;
+        maxDuration = std::max<std::chrono::nanoseconds>(maxDuration, duration);
+        if (duration > SLOW_DELIVERY) slowDelivered++;
+        delivered++;
+      }
+    }
+  }};
+
+  std::vector<std::thread> writers{};
+  for (int writer = 0; writer < WRITERS; writer++) {
+    writers.emplace_back([&table, writer]() {
+      const std::string filters[] = {"home/room1/+", "home/#", "home/+/light", "home/room7/humidity"};
+      for (int i = 0; i < CHANGES_PER_WRITER; i++) {
+        auto subscriber = std::make_unique<Subscriber>();
+        subscriber->topic = filters[(i + writer) % 4];
+        table.insert(subscriber.get());
+        std::this_thread::yield();
+        table.erase(subscriber.get());
+        subscriber->isErased = true;
+        // NOTE subscriber is freed here, delivery reaching it would be use after free
+      }
+    });
+  }
+  for (auto& writer : writers) writer.join();
+  isStopping = true;
+  delivery.join();
+
+  printf("%s: %u deliveries, erased subscriber reached %u times, delivery average %lld ns, max %lld us, %u slower "
+         "than %lld us\n",
+    name,
+    delivered,
+    erasedReached.load(),
+    static_cast<long long>(totalDuration.count() / std::max<uint32_t>(delivered, 1)),
+    static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(maxDuration).count()),
+    slowDelivered,
+    static_cast<long long>(SLOW_DELIVERY.count()));
+}
+
+extern "C" void app_main() {
+  stress<LockedTable>("locked table");
+  stress<LeftRightTable>("left-right table");
+}
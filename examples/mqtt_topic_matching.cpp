@@ -0,0 +1,79 @@
+#include "essentials/topic_trie.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace es = essentials;
+
+constexpr int DISPATCHES = 10000;
+
+/**
+ * @brief Naive filter matching used for comparison
+ */
+bool matches(std::string_view filter, std::string_view topic) {
+  while (true) {
+    const std::size_t filterEnd = std::min(filter.find('/'), filter.size());
+    const std::size_t topicEnd = std::min(topic.find('/'), topic.size());
+    const std::string_view filterLevel = filter.substr(0, filterEnd);
+    if (filterLevel == "#") return true;
+    if (filterLevel != "+" && filterLevel != topic.substr(0, topicEnd)) return false;
+    if (filterEnd == filter.size() || topicEnd == topic.size()) {
+      return filterEnd == filter.size() && topicEnd == topic.size();
+    }
+    filter.remove_prefix(filterEnd + 1);
+    topic.remove_prefix(topicEnd + 1);
+  }
+}
+
+void benchmark(int subscriptionCount) {
+  std::vector<std::string> filters;
+  for (int i = 0; i < subscriptionCount; i++) {
+    switch (i % 4) {
+      case 0: filters.push_back("home/room" + std::to_string(i) + "/temperature"); break;
+      case 1: filters.push_back("home/room" + std::to_string(i) + "/+"); break;
+      case 2: filters.push_back("home/+/sensor" + std::to_string(i)); break;
+      default: filters.push_back("devices/device" + std::to_string(i) + "/#"); break;
+    }
+  }
+
+  es::TopicTrie<int> trie;
+  for (int i = 0; i < subscriptionCount; i++) {
+    trie.insert(filters[i], i);
+  }
+
+  std::vector<std::string> topics;
+  for (int i = 0; i < 16; i++) {
+    topics.push_back("home/room" + std::to_string(i * subscriptionCount / 16) + "/temperature");
+  }
+
+  int matched = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < DISPATCHES; i++) {
+    trie.match(topics[i % topics.size()], [&matched](int) { matched++; });
+  }
+  auto trieDuration = std::chrono::steady_clock::now() - start;
+
+  int linearMatched = 0;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < DISPATCHES; i++) {
+    for (const std::string& filter : filters) {
+      if (matches(filter, topics[i % topics.size()])) linearMatched++;
+    }
+  }
+  auto linearDuration = std::chrono::steady_clock::now() - start;
+
+  printf("%4d subscriptions: trie %6.2f us/dispatch, linear %8.2f us/dispatch, matches %d/%d\n",
+    subscriptionCount,
+    std::chrono::duration<double, std::micro>(trieDuration).count() / DISPATCHES,
+    std::chrono::duration<double, std::micro>(linearDuration).count() / DISPATCHES,
+    matched,
+    linearMatched);
+}
+
+extern "C" void app_main() {
+  for (int subscriptionCount : {10, 50, 100, 250, 500}) {
+    benchmark(subscriptionCount);
+  }
+}
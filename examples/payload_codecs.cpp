@@ -0,0 +1,83 @@
+#include "essentials/codec.hpp"
+
+#include <cstdio>
+#include <string>
+
+namespace es = essentials;
+
+struct Position {
+  double latitude;
+  double longitude;
+};
+
+struct Reading {
+  float temperature;
+  int32_t humidity;
+  bool isCharging;
+  std::string status;
+  std::array<uint16_t, 4> samples;
+  Position position;
+};
+
+// NOTE descriptors are evaluated at compile time, encoding walks fields without any runtime reflection
+template<>
+struct es::Fields<Position> {
+  static constexpr auto value =
+    std::make_tuple(field("latitude", &Position::latitude), field("longitude", &Position::longitude));
+};
+
+template<>
+struct es::Fields<Reading> {
+  static constexpr auto value = std::make_tuple(field("temperature", &Reading::temperature),
+    field("humidity", &Reading::humidity),
+    field("isCharging", &Reading::isCharging),
+    field("status", &Reading::status),
+    field("samples", &Reading::samples),
+    field("position", &Reading::position));
+  static constexpr es::Codec codec = es::Codec::Cbor;
+};
+
+/**
+ * @brief Hand-written JSON used for comparison
+ */
+std::string toJson(const Reading& reading) {
+  char text[256];
+  snprintf(text,
+    sizeof(text),
+    "{\"temperature\":%g,\"humidity\":%d,\"isCharging\":%s,\"status\":\"%s\",\"samples\":[%u,%u,%u,%u],"
+    "\"position\":{\"latitude\":%.9g,\"longitude\":%.9g}}",
+    reading.temperature,
+    reading.humidity,
+    reading.isCharging ? "true" : "false",
+    reading.status.c_str(),
+    reading.samples[0],
+    reading.samples[1],
+    reading.samples[2],
+    reading.samples[3],
+    reading.position.latitude,
+    reading.position.longitude);
+  return text;
+}
+
+extern "C" void app_main() {
+  Reading reading{21.5f, 40, true, "ok", {512, 515, 509, 1023}, {50.0875311, 14.4212535}};
+
+  std::array<uint8_t, 128> buffer;
+  const std::size_t cborSize = es::encode(es::Codec::Cbor, reading, {buffer.data(), buffer.size()});
+  const std::size_t messagePackSize = es::encode(es::Codec::MessagePack, reading, {buffer.data(), buffer.size()});
+  printf("JSON %u B, CBOR %u B, MessagePack %u B\n",
+    unsigned(toJson(reading).size()),
+    unsigned(cborSize),
+    unsigned(messagePackSize));
+
+  Reading decoded{};
+  const bool isDecoded = es::decode(es::Codec::MessagePack, {buffer.data(), messagePackSize}, decoded);
+  printf("decoded: %s, temperature %.1f, status %s\n",
+    isDecoded ? "yes" : "no",
+    decoded.temperature,
+    decoded.status.c_str());
+
+  // NOTE with Mqtt, described structs are published and subscribed as any other typed value:
+  // mqtt.publish("reading", reading, es::Mqtt::Qos::Qos0, false);
+  // mqtt.subscribe<Reading>("reading", es::Mqtt::Qos::Qos0, [](std::optional<Reading> reading) { ... });
+}
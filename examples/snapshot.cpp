@@ -0,0 +1,52 @@
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "essentials/config.hpp"
+#include "essentials/esp32_storage.hpp"
+#include "essentials/snapshot.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <string>
+
+namespace es = essentials;
+
+extern "C" void app_main() {
+  // NOTE golden device prepares configuration
+  es::Esp32Storage goldenStorage{"golden"};
+  goldenStorage.clear();
+  es::Config golden{goldenStorage};
+  golden.get<std::string>("ssid") = std::string{"factory-wifi"};
+  golden.get<std::string>("wifiPass") = std::string{"secret"};
+  golden.get<std::string>("url") = std::string{"mqtts://broker.local"};
+  golden.get<int>("interval") = 60;
+
+  std::vector<uint8_t> snapshot = es::exportSnapshot(goldenStorage);
+  printf("snapshot: %zu B\n", snapshot.size());
+
+  // NOTE provisioned device writes whole snapshot with one commit
+  es::Esp32Storage storage{"provisioned"};
+  storage.clear();
+  uint32_t commitsBefore = storage.commitCount();
+  int64_t start = esp_timer_get_time();
+  std::size_t count = es::importSnapshot(storage, es::Span<uint8_t>{snapshot.data(), snapshot.size()});
+  printf("imported %zu values in %lld us with %u commits\n",
+    count,
+    esp_timer_get_time() - start,
+    storage.commitCount() - commitsBefore);
+
+  // NOTE later only changed values are transferred
+  golden.get<int>("interval") = 30;
+  std::vector<uint8_t> delta = es::exportSnapshot(goldenStorage, es::Span<uint8_t>{snapshot.data(), snapshot.size()});
+  printf("delta: %zu B, imported %zu values\n",
+    delta.size(),
+    es::importSnapshot(storage, es::Span<uint8_t>{delta.data(), delta.size()}));
+
+  es::Config config{storage};
+  printf("ssid: %s, interval: %d\n", config.get<std::string>("ssid")->c_str(), *config.get<int>("interval"));
+
+  goldenStorage.clear();
+  storage.clear();
+
+  vTaskDelay(pdMS_TO_TICKS(5000));
+  esp_restart();
+}
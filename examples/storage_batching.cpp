@@ -0,0 +1,63 @@
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "essentials/batched_storage.hpp"
+#include "essentials/config.hpp"
+#include "essentials/esp32_storage.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <array>
+#include <string>
+
+namespace es = essentials;
+
+constexpr int ROUNDS = 20;
+constexpr std::array<es::StorageKey, 5> KEYS{"ssid", "wifiPass", "url", "user", "pass"};
+
+void updateAll(es::Config& config, int round) {
+  for (const es::StorageKey& key : KEYS) {
+    auto value = config.get<std::string>(key);
+    value = std::string(key.view()) + std::to_string(round);
+  }
+  config.flush();
+}
+
+void printResult(const char* name, int64_t durationUs, uint32_t commits) {
+  printf("%s: %d updates, %lld us, %u commits, %.1f commits/s\n",
+    name,
+    ROUNDS * int(KEYS.size()),
+    durationUs,
+    commits,
+    commits * 1000000.0 / durationUs);
+}
+
+extern "C" void app_main() {
+  es::Esp32Storage storage{"benchmark"};
+  storage.clear();
+
+  {
+    es::Config config{storage};
+    uint32_t commitsBefore = storage.commitCount();
+    int64_t start = esp_timer_get_time();
+    for (int round = 0; round < ROUNDS; round++) {
+      updateAll(config, round);
+    }
+    printResult("direct", esp_timer_get_time() - start, storage.commitCount() - commitsBefore);
+  }
+
+  {
+    es::BatchedStorage batchedStorage{storage};
+    es::Config config{batchedStorage};
+    uint32_t commitsBefore = storage.commitCount();
+    int64_t start = esp_timer_get_time();
+    for (int round = 0; round < ROUNDS; round++) {
+      updateAll(config, round); // all 5 values are written with one commit
+    }
+    printResult("batched", esp_timer_get_time() - start, storage.commitCount() - commitsBefore);
+  }
+
+  storage.clear();
+
+  vTaskDelay(pdMS_TO_TICKS(5000));
+  esp_restart();
+}
@@ -0,0 +1,49 @@
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "essentials/compressed_storage.hpp"
+#include "essentials/config.hpp"
+#include "essentials/esp32_storage.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <string>
+
+namespace es = essentials;
+
+std::string makeDocument() {
+  std::string document = "{\"sensors\":[";
+  for (int i = 0; i < 32; i++) {
+    if (i > 0) document += ",";
+    document += "{\"name\":\"sensor" + std::to_string(i) + "\",\"offset\":" + std::to_string(i * 3 % 17)
+      + ",\"gain\":1.0" + std::to_string(i % 10) + ",\"enabled\":true}";
+  }
+  return document + "]}";
+}
+
+extern "C" void app_main() {
+  es::Esp32Storage storage{"compressed"};
+  storage.clear();
+  es::CompressedStorage compressedStorage{storage};
+  es::Config config{compressedStorage};
+
+  const std::string document = makeDocument();
+  auto calibration = config.get<std::string>("calibration");
+  calibration = document;
+
+  int64_t start = esp_timer_get_time();
+  std::string loaded = *calibration; // decompressed straight into the string's buffer
+  int64_t readUs = esp_timer_get_time() - start;
+
+  es::CompressedStorage::Stats stats = compressedStorage.stats();
+  printf("document: %zu B, stored: %d B, ratio: %.2f\n",
+    document.size(),
+    storage.size("calibration"),
+    float(stats.rawBytes) / stats.storedBytes);
+  printf("read: %lld us, decodes: %u, decode time: %llu us\n", readUs, stats.decodes, stats.decodeMicros);
+  printf("loaded document is %s\n", loaded == document ? "equal" : "different");
+
+  storage.clear();
+
+  vTaskDelay(pdMS_TO_TICKS(5000));
+  esp_restart();
+}
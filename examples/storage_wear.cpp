@@ -0,0 +1,43 @@
+#include "esp_system.h"
+#include "essentials/config.hpp"
+#include "essentials/esp32_storage.hpp"
+#include "essentials/wear_managed_storage.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+namespace es = essentials;
+
+extern "C" void app_main() {
+  es::Esp32Storage storage{"wear"};
+  storage.clear();
+  es::WearManagedStorage wearManagedStorage{storage, {5, std::chrono::seconds{10}}};
+  es::Config config{wearManagedStorage};
+
+  auto brightness = config.get<int>("brightness", 50);
+  auto mode = config.get<int>("mode", 1);
+  for (int i = 0; i < 100; i++) {
+    mode = 1; // identical value isn't written
+    brightness = 50 + i % 10; // writes over budget are deferred and merged
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+
+  es::WearManagedStorage::Stats stats = wearManagedStorage.stats();
+  printf("writes: %u, skipped: %u, coalesced: %u, deferred: %u, NVS commits: %u\n",
+    stats.writes,
+    stats.skipped,
+    stats.coalesced,
+    stats.deferred,
+    storage.commitCount());
+  for (const auto& keyStats : wearManagedStorage.keyStats()) {
+    printf("%s: writes: %u, skipped: %u, coalesced: %u\n",
+      keyStats.key.c_str(),
+      keyStats.writes,
+      keyStats.skipped,
+      keyStats.coalesced);
+  }
+
+  storage.clear();
+
+  vTaskDelay(pdMS_TO_TICKS(5000));
+  esp_restart();
+}
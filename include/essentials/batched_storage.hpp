@@ -0,0 +1,52 @@
+#pragma once
+
+#include "essentials/persistent_storage.hpp"
+
+#include <chrono>
+#include <memory>
+
+namespace essentials {
+
+/**
+ * @brief Write-behind storage. Writes are staged in RAM (merged per key) and written into underlying storage with
+ * a single batch write. Staged writes are flushed explicitly by flush(), after flush deadline or on destruction. The
+ * deadline flush runs on a task of the storage.
+ */
+struct BatchedStorage : PersistentStorage {
+  /**
+   * @brief Create batched storage on top of other storage
+   *
+   * @param storage underlying storage
+   * @param flushDeadline maximum time the first staged write waits for flush
+   */
+  explicit BatchedStorage(
+    PersistentStorage& storage, std::chrono::milliseconds flushDeadline = std::chrono::milliseconds{1000});
+  ~BatchedStorage();
+
+  int size(const StorageKey& key) const override;
+  std::vector<uint8_t> read(const StorageKey& key, int size) const override;
+  int readInto(const StorageKey& key, MutableSpan<uint8_t> buffer) const override;
+  void write(const StorageKey& key, Span<uint8_t> data) override;
+  void clear() override;
+  std::vector<StorageKey> keys() const override;
+  void flush() override;
+
+  /**
+   * @brief Start transaction. Writes in transaction are kept apart from write-behind staging and aren't flushed
+   * by deadline, commit() writes them as a single transaction of underlying storage.
+   */
+  void begin() override;
+  void commit() override;
+  void rollback() override;
+
+  /**
+   * @brief Number of keys waiting for flush
+   */
+  std::size_t stagedCount() const;
+
+private:
+  struct Private;
+  std::unique_ptr<Private> p;
+};
+
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace essentials {
+
+/**
+ * @brief Fixed number of equally sized buffers allocated once. Acquired buffer returns to the pool when its handle is
+ * destroyed.
+ */
+class BufferPool {
+public:
+  struct Stats {
+    uint32_t acquired;
+    /** @brief Number of failed acquires because all buffers were in use */
+    uint32_t exhausted;
+  };
+
+  class Buffer {
+  public:
+    Buffer() = default;
+    Buffer(Buffer&& other) noexcept : _pool(other._pool), _data(other._data) {
+      other._pool = nullptr;
+      other._data = nullptr;
+    }
+    Buffer& operator=(Buffer&& other) noexcept {
+      if (this != &other) {
+        release();
+        std::swap(_pool, other._pool);
+        std::swap(_data, other._data);
+      }
+      return *this;
+    }
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+    ~Buffer() {
+      release();
+    }
+
+    uint8_t* data() const {
+      return _data;
+    }
+
+    std::size_t size() const {
+      return _pool ? _pool->_bufferSize : 0;
+    }
+
+    explicit operator bool() const {
+      return _data != nullptr;
+    }
+
+    /**
+     * @brief Return buffer to the pool
+     */
+    void release() {
+      if (_pool) _pool->_release(_data);
+      _pool = nullptr;
+      _data = nullptr;
+    }
+
+  private:
+    friend class BufferPool;
+    Buffer(BufferPool* pool, uint8_t* data) : _pool(pool), _data(data) {
+    }
+
+    BufferPool* _pool = nullptr;
+    uint8_t* _data = nullptr;
+  };
+
+  BufferPool(std::size_t bufferCount, std::size_t bufferSize) :
+    _bufferSize(bufferSize), _memory(std::make_unique<uint8_t[]>(bufferCount * bufferSize)) {
+    _free.reserve(bufferCount);
+    for (std::size_t i = 0; i < bufferCount; i++) {
+      _free.push_back(_memory.get() + i * bufferSize);
+    }
+  }
+
+  /**
+   * @brief Acquire free buffer
+   *
+   * @return Buffer empty handle when all buffers are in use
+   */
+  Buffer acquire() {
+    std::lock_guard lock{_mutex};
+    if (_free.empty()) {
+      _stats.exhausted++;
+      return Buffer{};
+    }
+    _stats.acquired++;
+    uint8_t* data = _free.back();
+    _free.pop_back();
+    return Buffer{this, data};
+  }
+
+  std::size_t bufferSize() const {
+    return _bufferSize;
+  }
+
+  std::size_t available() const {
+    std::lock_guard lock{_mutex};
+    return _free.size();
+  }
+
+  Stats stats() const {
+    std::lock_guard lock{_mutex};
+    return _stats;
+  }
+
+private:
+  std::size_t _bufferSize;
+  std::unique_ptr<uint8_t[]> _memory;
+  std::vector<uint8_t*> _free{};
+  Stats _stats{};
+  mutable std::mutex _mutex{};
+
+  void _release(uint8_t* data) {
+    std::lock_guard lock{_mutex};
+    _free.push_back(data);
+  }
+};
+
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+#include "essentials/helpers.hpp"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace essentials {
+
+/**
+ * @brief Binary formats of structured payloads
+ */
+enum class Codec { MessagePack, Cbor };
+
+/**
+ * @brief Name and member pointer of one described field
+ */
+template<typename Class, typename Member>
+struct Field {
+  std::string_view name;
+  Member Class::*pointer;
+};
+
+template<typename Class, typename Member>
+constexpr Field<Class, Member> field(std::string_view name, Member Class::*pointer) {
+  return Field<Class, Member>{name, pointer};
+}
+
+/**
+ * @brief Compile-time description of struct's fields for codecs. Specialize it for a struct with a tuple of fields
+ * and optionally its codec (MessagePack is default):
+ *
+ * template<>
+ * struct essentials::Fields<Reading> {
+ *   static constexpr auto value = std::make_tuple(field("temperature", &Reading::temperature),
+ *     field("humidity", &Reading::humidity));
+ *   static constexpr Codec codec = Codec::Cbor;
+ * };
+ *
+ * Struct is encoded as a map of field names to values. Supported field types are bool, integral and floating point
+ * types, std::string, std::array of supported types and other described structs. Decoding skips unknown fields and
+ * missing fields keep their values, thus fields can be added or removed without breaking older receivers.
+ */
+template<typename T>
+struct Fields;
+
+template<typename T, typename = void>
+struct IsDescribed : std::false_type {};
+
+template<typename T>
+struct IsDescribed<T, std::void_t<decltype(Fields<T>::value)>> : std::true_type {};
+
+template<typename T>
+constexpr bool isDescribed = IsDescribed<T>::value;
+
+template<typename T, typename = void>
+struct CodecOf : std::integral_constant<Codec, Codec::MessagePack> {};
+
+template<typename T>
+struct CodecOf<T, std::void_t<decltype(Fields<T>::codec)>> : std::integral_constant<Codec, Fields<T>::codec> {};
+
+template<typename T>
+constexpr Codec codecOf = CodecOf<T>::value;
+
+template<typename T>
+struct IsStdArray : std::false_type {};
+
+template<typename T, std::size_t N>
+struct IsStdArray<std::array<T, N>> : std::true_type {};
+
+/**
+ * @brief Writes MessagePack or CBOR items into a buffer. Writing past the end of the buffer is only counted, thus
+ * size() tells how big buffer the whole payload needs.
+ */
+class Encoder {
+public:
+  Encoder(Codec codec, MutableSpan<uint8_t> buffer) : _codec(codec), _buffer(buffer) {
+  }
+
+  template<typename T>
+  void encode(const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+      writeBool(value);
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+      writeInteger(value);
+    } else if constexpr (std::is_integral_v<T>) {
+      writeUnsigned(value);
+    } else if constexpr (std::is_same_v<T, float>) {
+      writeFloat(value);
+    } else if constexpr (std::is_floating_point_v<T>) {
+      writeDouble(value);
+    } else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>) {
+      writeString(value);
+    } else if constexpr (IsStdArray<T>::value) {
+      writeArrayHeader(value.size());
+      for (const auto& item : value) encode(item);
+    } else {
+      static_assert(isDescribed<T>, "T must be bool, integral, floating point, string, std::array or described struct");
+      constexpr auto& fields = Fields<T>::value;
+      writeMapHeader(std::tuple_size_v<std::decay_t<decltype(fields)>>);
+      std::apply(
+        [this, &value](const auto&... field) { ((writeString(field.name), encode(value.*(field.pointer))), ...); },
+        fields);
+    }
+  }
+
+  void writeBool(bool value);
+  void writeInteger(int64_t value);
+  void writeUnsigned(uint64_t value);
+  void writeFloat(float value);
+  /**
+   * @brief Write double, it is written as float when it doesn't lose precision
+   */
+  void writeDouble(double value);
+  void writeString(std::string_view value);
+  void writeArrayHeader(std::size_t count);
+  void writeMapHeader(std::size_t count);
+
+  /**
+   * @brief Size of written payload, it is bigger than buffer when payload doesn't fit
+   */
+  std::size_t size() const {
+    return _position;
+  }
+
+private:
+  Codec _codec;
+  MutableSpan<uint8_t> _buffer;
+  std::size_t _position = 0;
+
+  void _write(uint8_t byte);
+  void _writeBigEndian(uint64_t value, int size);
+  void _writeBytes(const void* data, std::size_t size);
+  void _writeCborHead(uint8_t majorType, uint64_t value);
+};
+
+/**
+ * @brief Reads MessagePack or CBOR items from a payload. Reading fails on malformed payload or value which doesn't fit
+ * into the requested type.
+ */
+class Decoder {
+public:
+  struct Item {
+    enum class Type { Nil, Bool, Unsigned, Negative, Float, String, Bytes, Array, Map };
+
+    Type type;
+    bool boolean;
+    /** @brief Value of Unsigned, length of String and Bytes or count of Array and Map */
+    uint64_t unsignedValue;
+    int64_t negativeValue;
+    double number;
+    /** @brief Data of String or Bytes */
+    std::string_view data;
+  };
+
+  Decoder(Codec codec, Span<uint8_t> payload) : _codec(codec), _payload(payload) {
+  }
+
+  template<typename T>
+  bool decode(T& value) {
+    Item item;
+    if (!next(item)) return false;
+    return decodeItem(item, value);
+  }
+
+  template<typename T>
+  bool decodeItem(const Item& item, T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+      if (item.type != Item::Type::Bool) return false;
+      value = item.boolean;
+      return true;
+    } else if constexpr (std::is_integral_v<T>) {
+      if (item.type == Item::Type::Unsigned) {
+        if (item.unsignedValue > uint64_t(std::numeric_limits<T>::max())) return false;
+        value = T(item.unsignedValue);
+        return true;
+      }
+      if constexpr (std::is_signed_v<T>) {
+        if (item.type != Item::Type::Negative || item.negativeValue < int64_t(std::numeric_limits<T>::min())) {
+          return false;
+        }
+        value = T(item.negativeValue);
+        return true;
+      }
+      return false;
+    } else if constexpr (std::is_floating_point_v<T>) {
+      switch (item.type) {
+        case Item::Type::Float: value = T(item.number); return true;
+        case Item::Type::Unsigned: value = T(item.unsignedValue); return true;
+        case Item::Type::Negative: value = T(item.negativeValue); return true;
+        default: return false;
+      }
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      if (item.type != Item::Type::String) return false;
+      value.assign(item.data);
+      return true;
+    } else if constexpr (IsStdArray<T>::value) {
+      if (item.type != Item::Type::Array || item.unsignedValue != value.size()) return false;
+      for (auto& element : value) {
+        if (!decode(element)) return false;
+      }
+      return true;
+    } else {
+      static_assert(isDescribed<T>, "T must be bool, integral, floating point, string, std::array or described struct");
+      if (item.type != Item::Type::Map) return false;
+      for (uint64_t i = 0; i < item.unsignedValue; i++) {
+        Item key;
+        if (!next(key) || key.type != Item::Type::String) return false;
+        if (!_decodeField(key.data, value)) return false;
+      }
+      return true;
+    }
+  }
+
+  /**
+   * @brief Read head of the next item, data of strings and bytes are read too
+   */
+  bool next(Item& item);
+
+  /**
+   * @brief Skip content of an item whose head was read
+   */
+  bool skip(const Item& item);
+
+  bool isAtEnd() const {
+    return _position == _payload.size;
+  }
+
+private:
+  static constexpr int MAX_DEPTH = 16;
+
+  Codec _codec;
+  Span<uint8_t> _payload;
+  std::size_t _position = 0;
+  int _depth = 0;
+
+  bool _read(uint8_t& byte);
+  bool _readBigEndian(uint64_t& value, int size);
+  bool _readData(std::size_t size, std::string_view& data);
+  bool _nextMessagePack(Item& item);
+  bool _nextCbor(Item& item);
+
+  template<typename T>
+  bool _decodeField(std::string_view name, T& value) {
+    Item item;
+    if (!next(item)) return false;
+
+    bool isFound = false;
+    bool isDecoded = false;
+    std::apply(
+      [&](const auto&... field) {
+        auto decodeField = [&](const auto& field) {
+          if (isFound || field.name != name) return;
+          isFound = true;
+          isDecoded = decodeItem(item, value.*(field.pointer));
+        };
+        (decodeField(field), ...);
+      },
+      Fields<T>::value);
+    return isFound ? isDecoded : skip(item);
+  }
+};
+
+/**
+ * @brief Encode value into buffer without allocations
+ *
+ * @return std::size_t size of payload, payload is complete only if size isn't bigger than buffer
+ */
+template<typename T>
+std::size_t encode(Codec codec, const T& value, MutableSpan<uint8_t> buffer) {
+  Encoder encoder{codec, buffer};
+  encoder.encode(value);
+  return encoder.size();
+}
+
+/**
+ * @brief Decode value from payload, fields missing in payload keep their values
+ *
+ * @return true if whole payload was decoded
+ */
+template<typename T>
+bool decode(Codec codec, Span<uint8_t> payload, T& value) {
+  Decoder decoder{codec, payload};
+  return decoder.decode(value) && decoder.isAtEnd();
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "essentials/persistent_storage.hpp"
+
+#include <memory>
+
+namespace essentials {
+
+/**
+ * @brief Storage which compresses blobs written into underlying storage (see lzCompress). Small or incompressible
+ * blobs are stored uncompressed thus every blob costs only a small header. Reads decompress straight into caller's
+ * buffer.
+ *
+ * All blobs of underlying storage namespace must be written through compressed storage.
+ */
+struct CompressedStorage : PersistentStorage {
+  struct Stats {
+    /** @brief Size of written data before compression */
+    uint32_t rawBytes;
+    /** @brief Size of written data in underlying storage, compression ratio is rawBytes / storedBytes */
+    uint32_t storedBytes;
+    uint32_t decodes;
+    /** @brief Total time spent in decompression */
+    uint64_t decodeMicros;
+  };
+
+  /**
+   * @brief Create compressed storage on top of other storage
+   *
+   * @param storage underlying storage
+   * @param minCompressedSize blobs smaller than this size are stored uncompressed
+   */
+  explicit CompressedStorage(PersistentStorage& storage, std::size_t minCompressedSize = 32);
+  ~CompressedStorage();
+
+  int size(const StorageKey& key) const override;
+  std::vector<uint8_t> read(const StorageKey& key, int size) const override;
+  int readInto(const StorageKey& key, MutableSpan<uint8_t> buffer) const override;
+  void write(const StorageKey& key, Span<uint8_t> data) override;
+  void writeBatch(Span<Entry> entries) override;
+  void clear() override;
+  std::vector<StorageKey> keys() const override;
+  void flush() override;
+  void begin() override;
+  void commit() override;
+  void rollback() override;
+
+  Stats stats() const;
+
+private:
+  struct Private;
+  std::unique_ptr<Private> p;
+};
+
+}
@@ -1,17 +1,183 @@
 #pragma once
 
+#include "essentials/left_right.hpp"
 #include "essentials/persistent_storage.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 
 namespace essentials {
 
 class Config {
+public:
+  /**
+   * @brief Direct mode loads value from storage on every access. Cached mode loads value once and keeps it in RAM
+   * until it is changed by operator= or reloaded. Concurrent mode is cached mode where operator* doesn't modify the
+   * value handle thus one handle can be read from multiple tasks.
+   *
+   * Cache reads are wait-free in all modes, storage access and changes are serialized through one lock.
+   */
+  enum class Mode { Direct, Cached, Concurrent };
+
+  struct CacheStats {
+    uint32_t hits;
+    uint32_t misses;
+  };
+
+  struct Subscription {
+    std::optional<StorageKey> key;
+
+    ~Subscription() {
+      _unsubscribe();
+    }
+
+  private:
+    friend class Config;
+    // NOTE shared with running notification thus reaction can delete its own subscription
+    std::shared_ptr<const std::function<void(const StorageKey&)>> _reaction;
+    std::function<void()> _unsubscribe;
+  };
+
 protected:
+  struct State {
+    std::unordered_map<StorageKey, std::vector<uint8_t>, StorageKey::Hash> cache;
+    std::unordered_map<StorageKey, uint32_t, StorageKey::Hash> keyVersions;
+  };
+
+  /**
+   * @brief Cache, versions, subscriptions and transaction of a storage namespace shared by all configs on the storage
+   */
+  struct Shared {
+    LeftRight<State> state{};
+    std::atomic<uint32_t> version{0};
+    std::recursive_mutex writeMutex{};
+    std::vector<Subscription*> subscribers{};
+    /** @brief Nesting of running notifications, subscribers deleted meanwhile are cleared instead of erased */
+    int notifyingDepth = 0;
+    bool isInTransaction = false;
+    std::vector<StorageKey> pendingChanges{};
+  };
+
   PersistentStorage& _storage;
+  Mode _mode;
+  std::shared_ptr<Shared> _shared;
+  LeftRight<State>& _state;
+  std::recursive_mutex& _writeMutex;
+  std::atomic<uint32_t> _cacheHits{0};
+  std::atomic<uint32_t> _cacheMisses{0};
+
+  static std::shared_ptr<Shared> _sharedOf(PersistentStorage& storage);
+
+  /**
+   * @brief Read cached data with reader which returns false when cached data don't fit the value
+   */
+  template<typename Reader>
+  bool _readCached(const StorageKey& key, Reader&& reader) {
+    const bool isCached = _state.read([&key, &reader](const State& state) {
+      auto it = state.cache.find(key);
+      if (it == state.cache.end()) return false;
+      return reader(it->second);
+    });
+    (isCached ? _cacheHits : _cacheMisses).fetch_add(1, std::memory_order_relaxed);
+    return isCached;
+  }
+
+  void _storeCached(const StorageKey& key, Span<uint8_t> data);
+  /**
+   * @brief Update cache after write, direct mode only drops the key so other configs on the storage reload it
+   */
+  void _saveCached(const StorageKey& key, Span<uint8_t> data);
+  void _dropCached(const StorageKey& key);
+  void _changed(const StorageKey& key);
+  std::unique_ptr<Subscription> _subscribe(
+    std::optional<StorageKey> key, std::function<void(const StorageKey&)> reaction);
 
 public:
-  Config(PersistentStorage& storage);
+  /**
+   * @brief Create config on a storage namespace
+   *
+   * @param storage
+   * @param mode in cached modes values are loaded from storage once and kept in one cache. Cache, versions,
+   * subscriptions and transactions are shared by all configs on the same storage instance, thus a value changed
+   * through one config is seen by the others. NOTE changes written into the storage namespace through other storage
+   * instance (eg. a wrapping BatchedStorage) aren't seen by cache, reload() them.
+   */
+  Config(PersistentStorage& storage, Mode mode = Mode::Direct);
+
+  CacheStats cacheStats() const;
+
+  /**
+   * @brief Storage of this config. Configs on the same storage share cache, versions, subscriptions and transaction.
+   */
+  PersistentStorage& storage() const;
+
+  /**
+   * @brief Drop all cached values so next access of every value loads it from storage
+   */
+  void reload();
+
+  /**
+   * @brief Write out values staged by storage (see BatchedStorage)
+   */
+  void flush();
+
+  /**
+   * @brief Version of config's storage. Version increases whenever any value is changed by operator= of any config on
+   * the storage.
+   */
+  uint32_t version() const;
+
+  /**
+   * @brief Version of config when value of a key was changed last time or 0 if it wasn't changed yet
+   */
+  uint32_t version(const StorageKey& key) const;
+
+  /**
+   * @brief Cheap check without touching storage whether any value was changed since given version
+   */
+  bool hasChangedSince(uint32_t version) const;
+
+  /**
+   * @brief Subscribe to changes of a value. Reaction is called from the task which changed the value.
+   *
+   * @param key
+   * @param reaction callback with key of changed value
+   * @return std::unique_ptr<Subscription> delete of subscription results in unsubscribe
+   */
+  std::unique_ptr<Subscription> subscribe(const StorageKey& key, std::function<void(const StorageKey&)> reaction);
+
+  /**
+   * @brief Subscribe to changes of any value of this config. Reaction is called from the task which changed the value.
+   *
+   * @param reaction callback with key of changed value
+   * @return std::unique_ptr<Subscription> delete of subscription results in unsubscribe
+   */
+  std::unique_ptr<Subscription> subscribe(std::function<void(const StorageKey&)> reaction);
+
+  /**
+   * @brief Start transaction over multiple values. Other tasks can't change values of this config until transaction
+   * is committed or rolled back. Versions and subscriptions are notified about changes only after commit.
+   */
+  void begin();
+
+  /**
+   * @brief Write all values changed in transaction atomically (when storage supports transactions)
+   */
+  void commit();
+
+  /**
+   * @brief Drop all values changed in transaction
+   */
+  void rollback();
 
   template<typename T>
   class Value {
@@ -21,66 +187,293 @@ public:
     Config& _config;
     T _value;
     T _defaultValue;
-    std::string _key;
+    StorageKey _key;
     static constexpr int _dataSize = sizeof(T);
 
     friend class Config;
 
-    Value(Config& config, std::string_view key, T defaultValue) :
+    Value(Config& config, const StorageKey& key, T defaultValue) :
       _config(config), _value(defaultValue), _defaultValue(defaultValue), _key(key) {
     }
 
-    void _load() {
+    void _load(T& value) {
+      if (_config._mode != Mode::Direct) {
+        const bool isCached = _config._readCached(_key, [&value](const std::vector<uint8_t>& cached) {
+          if constexpr (std::is_same_v<T, std::string>) {
+            value.assign(cached.begin(), cached.end());
+          } else {
+            if (cached.size() != _dataSize) return false;
+            std::memcpy(&value, cached.data(), _dataSize);
+          }
+          return true;
+        });
+        if (isCached) return;
+      }
+
+      // NOTE default value of missing key isn't written into storage thus reading costs no flash write
+      std::lock_guard lock{_config._writeMutex};
       if constexpr (std::is_same_v<T, std::string>) {
-        int size = _config._storage.size(_key);
+        // NOTE read directly into string's buffer, reallocate only when stored string doesn't fit
+        value.resize(value.capacity());
+        int size = _config._storage.readInto(_key, _mutableData(value));
+        while (size > int(value.size())) {
+          value.resize(size);
+          size = _config._storage.readInto(_key, _mutableData(value));
+        }
         if (size <= 0) {
-          _value = _defaultValue;
-          _save();
+          value = _defaultValue;
         } else {
-          std::vector<uint8_t> data = _config._storage.read(_key, size);
-          _value = std::string(data.begin(), data.end());
+          value.resize(size);
         }
       } else {
-        std::vector<uint8_t> data = _config._storage.read(_key, _dataSize);
-        if (data.empty()) {
-          _value = _defaultValue;
-          _save();
-        } else {
-          _value = *reinterpret_cast<T*>(data.data());
+        T storedValue{};
+        int size = _config._storage.readInto(_key, _mutableData(storedValue));
+        if (size > _dataSize) {
+          throw std::runtime_error("stored value is bigger than value type");
         }
+        value = size <= 0 ? _defaultValue : storedValue;
       }
+
+      if (_config._mode != Mode::Direct) _config._storeCached(_key, _data(value));
     }
 
-    void _save() {
+    void _save(const T& value) {
+      std::lock_guard lock{_config._writeMutex};
+      _config._storage.write(_key, _data(value));
+      _config._saveCached(_key, _data(value));
+    }
+
+    static MutableSpan<uint8_t> _mutableData(T& value) {
       if constexpr (std::is_same_v<T, std::string>) {
-        _config._storage.write(_key, {reinterpret_cast<uint8_t*>(_value.data()), _value.size()});
+        return {reinterpret_cast<uint8_t*>(value.data()), value.size()};
       } else {
-        _config._storage.write(_key, {reinterpret_cast<uint8_t*>(&_value), _dataSize});
+        return {reinterpret_cast<uint8_t*>(&value), _dataSize};
+      }
+    }
+
+    static Span<uint8_t> _data(const T& value) {
+      if constexpr (std::is_same_v<T, std::string>) {
+        return {reinterpret_cast<const uint8_t*>(value.data()), value.size()};
+      } else {
+        return {reinterpret_cast<const uint8_t*>(&value), _dataSize};
       }
     }
 
   public:
     T operator*() {
-      _load();
+      if (_config._mode == Mode::Concurrent) {
+        T value{};
+        _load(value);
+        return value;
+      }
+      _load(_value);
       return _value;
     }
 
+    /**
+     * @brief Access value loaded into this handle. Don't share one handle among tasks for this operator.
+     */
     const T* operator->() {
-      _load();
+      _load(_value);
       return &_value;
     }
 
     Value& operator=(const T& newValue) {
-      _value = newValue;
-      _save();
+      std::lock_guard lock{_config._writeMutex};
+      _save(newValue);
+      _config._changed(_key);
+      return *this;
+    }
+
+    Config& config() const {
+      return _config;
+    }
+
+    /**
+     * @brief Version of config when this value was changed last time
+     */
+    uint32_t version() const {
+      return _config.version(_key);
+    }
+
+    /**
+     * @brief Drop cached value so next access loads it from storage
+     */
+    void reload() {
+      _config._dropCached(_key);
+    }
+  };
+
+  /**
+   * @brief Trivially copyable struct stored as one versioned and CRC checked blob thus whole struct is loaded with a
+   * single storage read. Mode of config applies to struct as to any other value.
+   *
+   * When stored version differs from current version, value starts with defaults, common prefix of stored data is
+   * copied (new fields appended at the end of struct keep their defaults) and migration is called to fix moved, renamed
+   * or changed fields. Migrated value is saved immediately. Missing or corrupted blob results in default value.
+   */
+  template<typename T>
+  class Struct {
+    static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types are allowed");
+
+  public:
+    /**
+     * @brief Migration from older struct version
+     *
+     * @param value value with defaults and copied common prefix of stored data
+     * @param storedVersion version of stored data
+     * @param storedData stored struct data
+     */
+    using Migration = std::function<void(T& value, uint16_t storedVersion, Span<uint8_t> storedData)>;
+
+  private:
+    struct Header {
+      uint16_t magic;
+      uint16_t version;
+      uint32_t size;
+      uint32_t crc;
+    };
+    static constexpr uint16_t _magic = 0x4553;
+    static constexpr std::size_t _blobSize = sizeof(Header) + sizeof(T);
+
+    Config& _config;
+    T _value;
+    T _defaultValue;
+    StorageKey _key;
+    uint16_t _version;
+    Migration _migration;
+
+    friend class Config;
+
+    Struct(Config& config, const StorageKey& key, uint16_t version, T defaultValue, Migration migration) :
+      _config(config),
+      _value(defaultValue),
+      _defaultValue(defaultValue),
+      _key(key),
+      _version(version),
+      _migration(std::move(migration)) {
+    }
+
+    void _load(T& value) {
+      if (_config._mode != Mode::Direct) {
+        const bool isCached = _config._readCached(_key, [&value](const std::vector<uint8_t>& cached) {
+          if (cached.size() != sizeof(T)) return false;
+          std::memcpy(&value, cached.data(), sizeof(T));
+          return true;
+        });
+        if (isCached) return;
+      }
+
+      std::lock_guard lock{_config._writeMutex};
+      value = _defaultValue;
+
+      std::array<uint8_t, _blobSize> buffer;
+      int size = _config._storage.readInto(_key, MutableSpan<uint8_t>{buffer.data(), buffer.size()});
+      if (size > int(buffer.size())) {
+        // NOTE stored struct of other version is bigger than current one
+        std::vector<uint8_t> biggerBuffer = _config._storage.read(_key, size);
+        _apply(Span<uint8_t>{biggerBuffer.data(), biggerBuffer.size()}, value);
+      } else if (size >= int(sizeof(Header))) {
+        _apply(Span<uint8_t>{buffer.data(), std::size_t(size)}, value);
+      }
+
+      if (_config._mode != Mode::Direct) _config._storeCached(_key, _data(value));
+    }
+
+    void _apply(Span<uint8_t> blob, T& value) {
+      Header header;
+      std::memcpy(&header, blob.data, sizeof(Header));
+      Span<uint8_t> data{blob.data + sizeof(Header), blob.size - sizeof(Header)};
+      if (header.magic != _magic || header.size != data.size || header.crc != crc32(data)) return;
+
+      std::memcpy(&value, data.data, std::min(data.size, sizeof(T)));
+      if (header.version == _version && data.size == sizeof(T)) return;
+
+      if (_migration) _migration(value, header.version, data);
+      _save(value);
+    }
+
+    void _save(const T& value) {
+      std::lock_guard lock{_config._writeMutex};
+      std::array<uint8_t, _blobSize> buffer;
+      Span<uint8_t> data = _data(value);
+      Header header{_magic, _version, sizeof(T), crc32(data)};
+      std::memcpy(buffer.data(), &header, sizeof(Header));
+      std::memcpy(buffer.data() + sizeof(Header), data.data, data.size);
+      _config._storage.write(_key, Span<uint8_t>{buffer.data(), buffer.size()});
+      _config._saveCached(_key, data);
+    }
+
+    static Span<uint8_t> _data(const T& value) {
+      return {reinterpret_cast<const uint8_t*>(&value), sizeof(T)};
+    }
+
+  public:
+    T operator*() {
+      if (_config._mode == Mode::Concurrent) {
+        T value;
+        _load(value);
+        return value;
+      }
+      _load(_value);
+      return _value;
+    }
+
+    /**
+     * @brief Access struct loaded into this handle. Don't share one handle among tasks for this operator.
+     */
+    const T* operator->() {
+      _load(_value);
+      return &_value;
+    }
+
+    Struct& operator=(const T& newValue) {
+      std::lock_guard lock{_config._writeMutex};
+      _save(newValue);
+      _config._changed(_key);
       return *this;
     }
+
+    Config& config() const {
+      return _config;
+    }
+
+    /**
+     * @brief Version of config when this struct was changed last time
+     */
+    uint32_t version() const {
+      return _config.version(_key);
+    }
+
+    /**
+     * @brief Drop cached struct so next access loads it from storage
+     */
+    void reload() {
+      _config._dropCached(_key);
+    }
   };
 
   template<typename T>
-  Value<T> get(std::string_view key, T defaultValue = T{}) {
+  Value<T> get(const StorageKey& key, T defaultValue = T{}) {
     return Value<T>{*this, key, defaultValue};
   }
+
+  /**
+   * @brief Get struct stored as a single blob
+   *
+   * @tparam T trivially copyable struct
+   * @param key
+   * @param version current version of the struct, increase it whenever struct layout changes
+   * @param defaultValue value used when stored blob is missing or corrupted
+   * @param migration migration from older stored versions
+   */
+  template<typename T>
+  Struct<T> getStruct(const StorageKey& key,
+    uint16_t version,
+    T defaultValue = T{},
+    typename Struct<T>::Migration migration = nullptr) {
+    return Struct<T>{*this, key, version, defaultValue, std::move(migration)};
+  }
 };
 
 }
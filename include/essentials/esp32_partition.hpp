@@ -0,0 +1,28 @@
+#pragma once
+
+#include "esp_partition.h"
+#include "essentials/partition.hpp"
+
+#include <string_view>
+
+namespace essentials {
+
+struct Esp32Partition : Partition {
+  /**
+   * @brief Open data partition from partition table
+   *
+   * @param label partition label
+   */
+  explicit Esp32Partition(std::string_view label);
+
+  std::size_t size() const override;
+  std::size_t sectorSize() const override;
+  void read(std::size_t offset, MutableSpan<uint8_t> buffer) const override;
+  void write(std::size_t offset, Span<uint8_t> data) override;
+  void erase(std::size_t offset, std::size_t size) override;
+
+private:
+  const esp_partition_t* _partition;
+};
+
+}
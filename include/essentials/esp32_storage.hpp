@@ -3,7 +3,9 @@
 #include "essentials/persistent_storage.hpp"
 #include "nvs.h"
 
+#include <optional>
 #include <string>
+#include <unordered_map>
 
 namespace essentials {
 
@@ -11,15 +13,46 @@ struct Esp32Storage : PersistentStorage {
   explicit Esp32Storage(std::string_view name);
   ~Esp32Storage();
 
-  int size(std::string_view key) const override;
-  std::vector<uint8_t> read(std::string_view key, int size) const override;
-  void write(std::string_view key, Span<uint8_t> data) override;
+  int size(const StorageKey& key) const override;
+  std::vector<uint8_t> read(const StorageKey& key, int size) const override;
+  void write(const StorageKey& key, Span<uint8_t> data) override;
+  int readInto(const StorageKey& key, MutableSpan<uint8_t> buffer) const override;
+  void writeBatch(Span<Entry> entries) override;
   void clear() override;
+  std::vector<StorageKey> keys() const override;
+
+  /**
+   * @brief Begin transaction. Writes are staged in RAM until commit.
+   */
+  void begin() override;
+
+  /**
+   * @brief Write staged data atomically with a single NVS commit. Staged data are written into a journal first, so
+   * transaction interrupted by power loss is finished when the storage is opened again. When a write fails, previous
+   * values are restored and the journal is erased, thus failed transaction isn't applied later.
+   *
+   * @throws std::runtime_error when writing fails
+   */
+  void commit() override;
+  void rollback() override;
+
+  /**
+   * @brief Number of NVS commits done by this storage
+   */
+  uint32_t commitCount() const;
 
 private:
+  static constexpr StorageKey JOURNAL_KEY = "_journal";
+
   void initialize();
+  void recoverJournal();
+  void set(const StorageKey& key, Span<uint8_t> data);
+  void erase(const StorageKey& key);
+  void commitNvs();
   nvs_handle_t _nvsHandle;
   std::string _name;
+  uint32_t _commitCount = 0;
+  std::optional<std::unordered_map<StorageKey, std::vector<uint8_t>, StorageKey::Hash>> _transaction{};
 };
 
 }
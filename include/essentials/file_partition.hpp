@@ -0,0 +1,40 @@
+#pragma once
+
+#include "essentials/partition.hpp"
+
+#include <cstdio>
+#include <string_view>
+
+namespace essentials {
+
+/**
+ * @brief Partition emulated in a file (eg. for testing on Linux). Emulates flash semantics, write can only clear bits
+ * and erase sets bytes to 0xFF.
+ */
+struct FilePartition : Partition {
+  /**
+   * @brief Open or create file-backed partition
+   *
+   * @param path file path
+   * @param size partition size, multiple of sector size
+   * @param sectorSize
+   */
+  FilePartition(std::string_view path, std::size_t size, std::size_t sectorSize = 4096);
+  ~FilePartition();
+
+  std::size_t size() const override;
+  std::size_t sectorSize() const override;
+  void read(std::size_t offset, MutableSpan<uint8_t> buffer) const override;
+  void write(std::size_t offset, Span<uint8_t> data) override;
+  void erase(std::size_t offset, std::size_t size) override;
+
+private:
+  void seek(std::size_t offset) const;
+  void checkRange(std::size_t offset, std::size_t size) const;
+
+  std::FILE* _file;
+  std::size_t _size;
+  std::size_t _sectorSize;
+};
+
+}
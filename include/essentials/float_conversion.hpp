@@ -0,0 +1,42 @@
+#pragma once
+
+#include "essentials/helpers.hpp"
+
+#include <cstddef>
+#include <string_view>
+
+namespace essentials {
+
+/**
+ * @brief Buffer size which fits any number formatted by formatFloat
+ */
+constexpr std::size_t MAX_FLOAT_CHARS = 32;
+
+/**
+ * @brief Format floating point number into a short text which is parsed back into the same number. Text is the
+ * shortest possible for more than 99.9% of numbers (Grisu2), others get one more digit. Magnitudes in [1e-4, 1e15)
+ * are formatted in fixed notation with at least one decimal digit (eg. 0.1, 42.0), others in scientific notation
+ * (eg. 1.5e+20). Doesn't allocate.
+ *
+ * @param number
+ * @param output
+ * @return std::size_t size of text or 0 when number isn't finite or text doesn't fit into output
+ */
+std::size_t formatFloat(double number, MutableSpan<char> output);
+std::size_t formatFloat(float number, MutableSpan<char> output);
+
+/**
+ * @brief Parse floating point number without allocations and exceptions. Text after the number is ignored.
+ *
+ * Decimal numbers of any length are parsed, text with more than 40 significant digits can differ from the closest
+ * number by one unit in the last place. Infinity, NaN and hexadecimal numbers are limited to 63 characters.
+ *
+ * @param text
+ * @param number parsed number, it is changed only on success
+ * @return true if text starts with a number which is in range of the type
+ */
+bool parseFloat(std::string_view text, double& number);
+bool parseFloat(std::string_view text, float& number);
+bool parseFloat(std::string_view text, long double& number);
+
+}
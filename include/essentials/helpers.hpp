@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 
 namespace essentials {
 
@@ -11,4 +12,20 @@ struct Span {
   std::size_t size;
 };
 
+// TODO replace with std::span when esp-idf will use toolchain with std::span
+template<typename T>
+struct MutableSpan {
+  T* data;
+  std::size_t size;
+};
+
+/**
+ * @brief CRC-32 (IEEE 802.3) of data
+ *
+ * @param data
+ * @param crc CRC of preceding data when computing CRC of data in chunks
+ * @return uint32_t
+ */
+uint32_t crc32(Span<uint8_t> data, uint32_t crc = 0);
+
 }
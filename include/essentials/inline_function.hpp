@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace essentials {
+
+template<typename Signature, std::size_t Capacity>
+class InlineFunction;
+
+/**
+ * @brief Move-only replacement of std::function which stores callable inside itself thus it never allocates. Callable
+ * bigger than Capacity bytes doesn't compile. Calling it costs one indirect call.
+ *
+ * @tparam R return type
+ * @tparam Args argument types
+ * @tparam Capacity maximum size of stored callable (eg. lambda with its captures)
+ */
+template<typename R, typename... Args, std::size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+public:
+  InlineFunction() = default;
+
+  InlineFunction(std::nullptr_t) {
+  }
+
+  template<typename F,
+    typename std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineFunction> &&
+                              std::is_invocable_r_v<R, std::decay_t<F>&, Args...>>* = nullptr>
+  InlineFunction(F&& callable) {
+    using Callable = std::decay_t<F>;
+    static_assert(sizeof(Callable) <= Capacity, "callable doesn't fit into capacity of InlineFunction");
+    static_assert(alignof(Callable) <= alignof(std::max_align_t), "callable is over-aligned for InlineFunction");
+    static_assert(std::is_nothrow_move_constructible_v<Callable>, "callable must be nothrow move constructible");
+
+    new (&_storage) Callable(std::forward<F>(callable));
+    _invoke = [](void* storage, Args... args) -> R {
+      return (*static_cast<Callable*>(storage))(std::forward<Args>(args)...);
+    };
+    _relocate = [](void* storage, void* destination) {
+      auto* callable = static_cast<Callable*>(storage);
+      if (destination) new (destination) Callable(std::move(*callable));
+      callable->~Callable();
+    };
+  }
+
+  InlineFunction(InlineFunction&& other) noexcept {
+    _moveFrom(other);
+  }
+
+  InlineFunction& operator=(InlineFunction&& other) noexcept {
+    if (this != &other) {
+      _reset();
+      _moveFrom(other);
+    }
+    return *this;
+  }
+
+  InlineFunction& operator=(std::nullptr_t) {
+    _reset();
+    return *this;
+  }
+
+  InlineFunction(const InlineFunction&) = delete;
+  InlineFunction& operator=(const InlineFunction&) = delete;
+
+  ~InlineFunction() {
+    _reset();
+  }
+
+  R operator()(Args... args) const {
+    return _invoke(&_storage, std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const {
+    return _invoke != nullptr;
+  }
+
+private:
+  // NOTE mutable like target of std::function, callable can change its captures
+  mutable std::aligned_storage_t<Capacity, alignof(std::max_align_t)> _storage;
+  R (*_invoke)(void*, Args...) = nullptr;
+  // NOTE move constructs callable into destination (if any) and destroys the original
+  void (*_relocate)(void*, void*) = nullptr;
+
+  void _moveFrom(InlineFunction& other) {
+    if (!other._invoke) return;
+    other._relocate(&other._storage, &_storage);
+    _invoke = other._invoke;
+    _relocate = other._relocate;
+    other._invoke = nullptr;
+    other._relocate = nullptr;
+  }
+
+  void _reset() {
+    if (!_invoke) return;
+    _relocate(&_storage, nullptr);
+    _invoke = nullptr;
+    _relocate = nullptr;
+  }
+};
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace essentials {
+
+/**
+ * @brief Left-Right concurrency control. Keeps two instances of T. Readers are wait-free and never block on writers,
+ * they read an instance which isn't being modified. Writers are serialized, modify the inactive instance, switch
+ * readers to it and wait until readers leave the other instance to modify it too. Thus writer function must be
+ * deterministic because it is applied to both instances.
+ */
+template<typename T>
+class LeftRight {
+public:
+  template<typename Reader>
+  auto read(Reader&& reader) const {
+    const int versionIndex = _versionIndex.load();
+    _readIndicators[versionIndex].fetch_add(1);
+
+    struct Departure {
+      std::atomic<int>& readIndicator;
+      ~Departure() {
+        readIndicator.fetch_sub(1);
+      }
+    } departure{_readIndicators[versionIndex]};
+
+    return reader(_instances[_leftRight.load()]);
+  }
+
+  template<typename Writer>
+  void modify(Writer&& writer) {
+    std::lock_guard lock{_writerMutex};
+    const int readInstance = _leftRight.load();
+    writer(_instances[1 - readInstance]);
+    _leftRight.store(1 - readInstance);
+
+    const int previousVersionIndex = _versionIndex.load();
+    const int nextVersionIndex = 1 - previousVersionIndex;
+    _waitForReaders(nextVersionIndex);
+    _versionIndex.store(nextVersionIndex);
+    _waitForReaders(previousVersionIndex);
+
+    writer(_instances[readInstance]);
+  }
+
+private:
+  std::array<T, 2> _instances{};
+  mutable std::array<std::atomic<int>, 2> _readIndicators{};
+  std::atomic<int> _leftRight{0};
+  std::atomic<int> _versionIndex{0};
+  std::mutex _writerMutex{};
+
+  void _waitForReaders(int versionIndex) const {
+    // NOTE sleep instead of yield so lower priority reader task can finish its read
+    while (_readIndicators[versionIndex].load() != 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+  }
+};
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "essentials/partition.hpp"
+#include "essentials/persistent_storage.hpp"
+
+#include <memory>
+
+namespace essentials {
+
+/**
+ * @brief Append-only log-structured key-value storage over a raw partition.
+ *
+ * Every write appends a CRC checked record into the current sector and RAM index points to the latest record of each
+ * key. Full sectors are compacted oldest first by copying their live records to the head of the log, which also spreads
+ * wear evenly over the partition. Interrupted writes and compactions are recovered when storage is opened. A record
+ * must fit into one sector.
+ */
+struct LogStorage : PersistentStorage {
+  struct Stats {
+    uint32_t bytesWritten;
+    uint32_t sectorErases;
+    uint32_t compactions;
+  };
+
+  /**
+   * @brief Open log storage on a partition and rebuild its index
+   *
+   * @param partition partition with at least 3 sectors
+   * @param isCompactedInBackground compact sectors in background thread before writes run out of free sectors
+   */
+  explicit LogStorage(Partition& partition, bool isCompactedInBackground = false);
+  ~LogStorage();
+
+  int size(const StorageKey& key) const override;
+  std::vector<uint8_t> read(const StorageKey& key, int size) const override;
+  int readInto(const StorageKey& key, MutableSpan<uint8_t> buffer) const override;
+  void write(const StorageKey& key, Span<uint8_t> data) override;
+  void clear() override;
+  std::vector<StorageKey> keys() const override;
+
+  /**
+   * @brief Compact the oldest sector if it contains stale records
+   *
+   * @return true if a sector was compacted
+   */
+  bool compact();
+
+  Stats stats() const;
+
+private:
+  struct Private;
+  std::unique_ptr<Private> p;
+};
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "essentials/helpers.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace essentials {
+
+/**
+ * @brief Hash table of LZ compressor, it is kept by caller so repeated compression doesn't allocate
+ */
+using LzHashTable = std::array<uint32_t, 1024>;
+
+/**
+ * @brief Compress data with small LZ77 codec (LZ4 block like format with 64kB window). Decompression needs no memory
+ * besides output buffer thus it is suitable for MCU.
+ *
+ * @param input
+ * @param output
+ * @param table
+ * @return std::size_t size of compressed data or 0 when compressed data don't fit into output
+ */
+std::size_t lzCompress(Span<uint8_t> input, MutableSpan<uint8_t> output, LzHashTable& table);
+
+/**
+ * @brief Decompress data compressed by lzCompress
+ *
+ * @param input
+ * @param output
+ * @return int size of decompressed data or -1 when input is malformed or decompressed data don't fit into output
+ */
+int lzDecompress(Span<uint8_t> input, MutableSpan<uint8_t> output);
+
+}
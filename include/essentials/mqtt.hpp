@@ -1,6 +1,15 @@
 #pragma once
 
+#include "essentials/buffer_pool.hpp"
+#include "essentials/codec.hpp"
+#include "essentials/float_conversion.hpp"
+#include "essentials/helpers.hpp"
+#include "essentials/inline_function.hpp"
+#include "essentials/outbound_queue.hpp"
+#include "essentials/payload_sink.hpp"
+
 #include <array>
+#include <atomic>
 #include <charconv>
 #include <chrono>
 #include <cmath>
@@ -8,12 +17,18 @@
 #include <limits>
 #include <memory>
 #include <optional>
+#include <string>
 #include <string_view>
 #include <type_traits>
+#include <vector>
 
 namespace essentials {
 
 struct Mqtt {
+private:
+  struct Private;
+
+public:
   static constexpr std::string_view FALSE_LITERAL = "false";
   static constexpr std::string_view TRUE_LITERAL = "true";
   static constexpr std::string_view NAN_LITERAL = "NaN";
@@ -35,18 +50,92 @@ struct Mqtt {
     int32_t totalLength;
   };
 
+  /**
+   * @brief Integrity check of messages streamed into a PayloadSink. Completeness (all fragments in order, total
+   * length) is checked always.
+   */
+  enum class Integrity {
+    /** @brief Message is the payload, its CRC is computed while it streams */
+    Length,
+    /** @brief Last 4 bytes of message are little-endian CRC-32 of the payload before them (see crc32) */
+    Crc32,
+  };
+
+  /**
+   * @brief Maximum size of subscription's callable including its captures, bigger callable doesn't compile
+   */
+  static constexpr std::size_t REACTION_CAPACITY = 24 * sizeof(void*);
+
+  using Reaction = InlineFunction<void(const Data&), REACTION_CAPACITY>;
+
+  /**
+   * @brief Default maximum size of messages reassembled for subscriptions of strings and described structs
+   */
+  static constexpr std::size_t DEFAULT_MAX_MESSAGE_SIZE = 16 * 1024;
+
+  /**
+   * @brief Order in which dispatch workers run reactions of waiting messages, see setDispatchWorkers()
+   */
+  enum class Priority { Low, Normal, High };
+
+  struct DispatchStats {
+    uint32_t posted;
+    uint32_t dispatched;
+    /** @brief Messages dropped because queue or message buffers of a worker were full */
+    uint32_t dropped;
+    /** @brief Messages waiting for workers */
+    uint32_t depth;
+    uint32_t maxDepth;
+  };
+
+  struct ReconnectStats {
+    uint32_t connects;
+    /** @brief Connects which resumed persistent session, only subscriptions changed meanwhile were sent */
+    uint32_t resumedSessions;
+    /** @brief SUBSCRIBE and UNSUBSCRIBE packets sent */
+    uint32_t subscriptionChanges;
+    /** @brief Time from the last connect until broker acknowledged all subscriptions, zero until then */
+    std::chrono::microseconds timeToReady;
+  };
+
   struct Subscription {
     std::string_view topic;
     Qos qos;
+    /** @brief Priority of subscription's messages when they are dispatched by workers */
+    std::atomic<Priority> priority{Priority::Normal};
 
-    ~Subscription() {
-      _unsubscribe();
+    ~Subscription();
+
+    // NOTE subscriptions are allocated from a pool of blocks which are reused
+    static void* operator new(std::size_t size);
+    static void operator delete(void* pointer);
+
+  private:
+    friend struct Mqtt;
+    friend struct Dispatcher;
+    // NOTE shared with subscribers table and messages waiting for dispatch thus they never reach freed state
+    struct State;
+    Private* _mqtt = nullptr;
+    std::shared_ptr<State> _state;
+  };
+
+  /**
+   * @brief Prefixed and NUL-terminated topic prepared once for repeated publishing without allocations
+   */
+  struct Topic {
+    std::string_view view() const {
+      return _topic;
+    }
+
+    const char* c_str() const {
+      return _topic.c_str();
     }
 
   private:
     friend struct Mqtt;
-    std::function<void(const Data&)> _reaction;
-    std::function<void()> _unsubscribe;
+    explicit Topic(std::string topic) : _topic(std::move(topic)) {
+    }
+    std::string _topic;
   };
 
   struct LastWillMessage {
@@ -69,6 +158,10 @@ struct Mqtt {
    * @param bufferSize buffer size for MQTT data. Incoming messages bigger than bufferSize will result in calling
    * subscribe's reaction multiple times. For bigger data sizes use reaction function with parameter const Mqtt::Data&
    * which tells you info about incoming data chunk (offset, total length).
+   * @param isSessionPersistent broker keeps subscriptions (and QoS 1 and 2 messages) of the client while it is
+   * disconnected, thus after reconnect only subscriptions changed meanwhile are sent. Client id must stay the same,
+   * default client id of esp-mqtt is derived from MAC address. NOTE topics subscribed before restart stay in the
+   * session until broker expires it, their messages are ignored.
    */
   Mqtt(ConnectionInfo connectionInfo,
     std::string_view topicsPrefix,
@@ -76,23 +169,39 @@ struct Mqtt {
     std::optional<LastWillMessage> lastWillMessage = std::nullopt,
     std::function<void()> onConnect = nullptr,
     std::function<void()> onDisconnect = nullptr,
-    int32_t bufferSize = 1024);
+    int32_t bufferSize = 1024,
+    bool isSessionPersistent = false);
   ~Mqtt();
 
   bool isConnected() const;
 
-  // TODO implement subscription to multi-level and single-level wildcard topics (eg. 'example/#',
-  // 'example/+/temperature')
   /**
-   * @brief Subscribe to a given MQTT topic with a callback
+   * @brief Make topic handle for publishing
    *
-   * @param topic MQTT topic to subscribe. Topic's prefix is prepended.
+   * @param topic MQTT topic. Topic's prefix is prepended.
+   * @return Topic
+   */
+  Topic topic(std::string_view topic) const;
+
+  /**
+   * @brief Subscribe to a given MQTT topic with a callback. Subscribing and unsubscribing from any thread never blocks
+   * delivery of messages. Delete of subscription waits until its running reaction returns, after that the reaction
+   * isn't called. Reaction can subscribe and unsubscribe too, such changes apply once the message is delivered.
+   * Subscriptions of the same topic share one broker subscription with their highest QoS, broker is unsubscribed
+   * when the last of them is deleted. Reaction is stored inside the subscription (see REACTION_CAPACITY) and
+   * subscriptions come from a pool (see reserveSubscriptions()), thus subscribing doesn't allocate for them.
+   *
+   * @param topic MQTT topic to subscribe. Topic's prefix is prepended. Topic can contain single-level '+' and
+   * multi-level '#' wildcards (eg. 'example/#', 'example/+/temperature').
    * @param qos MQTT qos
    * @param reaction callback function. Callback parameter contains info about incoming data chunk. If buffer is not big
    * enough, this callback is called multiple times.
    * @return std::unique_ptr<Subscription> delete of subscription results in MQTT unsubscribe
    */
-  std::unique_ptr<Subscription> subscribe(std::string_view topic, Qos qos, std::function<void(const Data&)> reaction);
+  template<typename F, typename std::enable_if_t<std::is_invocable_v<F&, const Data&>>* = nullptr>
+  std::unique_ptr<Subscription> subscribe(std::string_view topic, Qos qos, F reaction) {
+    return _subscribe(topic, qos, Reaction{std::move(reaction)});
+  }
 
   /**
    * @brief Subscribe to a given MQTT topic with a callback
@@ -103,39 +212,94 @@ struct Mqtt {
    * enough, this callback is called multiple times thus data will be fragmented.
    * @return std::unique_ptr<Subscription> delete of subscription results in MQTT unsubscribe
    */
+  template<typename F,
+    typename std::enable_if_t<std::is_invocable_v<F&, std::string_view> &&
+                              !std::is_invocable_v<F&, const Data&>>* = nullptr>
+  std::unique_ptr<Subscription> subscribe(std::string_view topic, Qos qos, F reaction) {
+    return _subscribe(
+      topic, qos, Reaction{[reaction = std::move(reaction)](const Data& data) mutable { reaction(data.data); }});
+  }
+
+  /**
+   * @brief Subscribe to a given MQTT topic with a callback which gets whole messages. Fragments of messages bigger than
+   * MQTT buffer are collected into a buffer acquired from a pool. Messages which aren't fragmented are passed without
+   * copying. Messages bigger than maxSize or arriving when the pool is exhausted are dropped.
+   *
+   * @param topic MQTT topic to subscribe. Topic's prefix is prepended.
+   * @param qos MQTT qos
+   * @param pool pool of buffers for fragmented messages
+   * @param maxSize maximum message size, it is limited by pool's buffer size
+   * @param reaction callback function with whole message
+   * @return std::unique_ptr<Subscription> delete of subscription results in MQTT unsubscribe
+   */
+  template<typename F>
   std::unique_ptr<Subscription> subscribe(
-    std::string_view topic, Qos qos, std::function<void(std::string_view)> reaction);
+    std::string_view topic, Qos qos, BufferPool& pool, std::size_t maxSize, F reaction) {
+    return _subscribeWhole(topic, qos, Reassembly{maxSize, &pool}, std::move(reaction));
+  }
 
   /**
-   * @brief Subscribe to a given MQTT topic with a callback with value conversion
+   * @brief Subscribe to a given MQTT topic and stream messages into a sink (eg. firmware assets or certificate bundles
+   * into a partition or storage). Fragments are written as they arrive, thus RAM use doesn't depend on message size.
+   * Payload is committed only when all fragments arrived and the written data match its CRC, otherwise it is aborted.
+   * Sink must outlive the subscription.
    *
-   * @tparam T type for value conversion (supported types are bool, integral types, floating point types). Bool type
-   * expects messages with a value "false" (FALSE_LITERAL), "true" (TRUE_LITERAL) on topic.
    * @param topic MQTT topic to subscribe. Topic's prefix is prepended.
    * @param qos MQTT qos
-   * @param reaction callback function. Callback parameter contains converted data into given T type
+   * @param sink destination of payloads
+   * @param integrity integrity check of payloads
+   * @param reaction callback function with bool parameter, true when payload was committed and false when it was
+   * dropped
    * @return std::unique_ptr<Subscription> delete of subscription results in MQTT unsubscribe
    */
-  template<typename T, typename std::enable_if_t<!std::is_constructible_v<std::string_view, T>>* = nullptr>
+  template<typename F, typename std::enable_if_t<std::is_invocable_v<F&, bool>>* = nullptr>
   std::unique_ptr<Subscription> subscribe(
-    std::string_view topic, Qos qos, std::function<void(std::optional<T>)> reaction) {
-    return subscribe(topic, qos, [reaction](std::string_view data) { reaction(_fromString<T>(data)); });
+    std::string_view topic, Qos qos, PayloadSink& sink, Integrity integrity, F reaction) {
+    return _subscribe(topic,
+      qos,
+      Reaction{[streaming = Streaming{&sink, integrity}, reaction = std::move(reaction)](const Data& data) mutable {
+        if (std::optional<bool> isCommitted = streaming.append(data)) reaction(*isCommitted);
+      }});
+  }
+
+  /**
+   * @brief Subscribe to a given MQTT topic with a callback with value conversion. Fragmented messages are reassembled
+   * before conversion, messages of described structs bigger than maxMessageSize() are dropped.
+   *
+   * @tparam T type for value conversion (supported types are bool, integral types, floating point types and structs
+   * described by essentials::Fields). Bool type expects messages with a value "false" (FALSE_LITERAL), "true"
+   * (TRUE_LITERAL) on topic. Described structs are decoded from their MessagePack or CBOR payload.
+   * @param topic MQTT topic to subscribe. Topic's prefix is prepended.
+   * @param qos MQTT qos
+   * @param reaction callback function. Callback parameter contains converted data into given T type
+   * @return std::unique_ptr<Subscription> delete of subscription results in MQTT unsubscribe
+   */
+  template<typename T, typename F, typename std::enable_if_t<std::is_invocable_v<F&, std::optional<T>>>* = nullptr>
+  std::unique_ptr<Subscription> subscribe(std::string_view topic, Qos qos, F reaction) {
+    return _subscribeWhole(topic,
+      qos,
+      Reassembly{_maxSizeOf<T>(), nullptr},
+      [reaction = std::move(reaction)](std::string_view data) mutable { reaction(_fromString<T>(data)); });
   }
 
   /**
    * @brief Subscribe to a given MQTT topic with a value reference. Value is changed automatically when new message
-   * arrive.
+   * arrive. Fragmented messages are reassembled before conversion, messages of strings and described structs bigger
+   * than maxMessageSize() are dropped.
    *
-   * @tparam T type for value conversion (supported types are bool, integral types, floating point types). Bool type
-   * expects messages with a value "false" (FALSE_LITERAL), "true" (TRUE_LITERAL) on topic.
+   * @tparam T type for value conversion (supported types are bool, integral types, floating point types and structs
+   * described by essentials::Fields). Bool type expects messages with a value "false" (FALSE_LITERAL), "true"
+   * (TRUE_LITERAL) on topic. Described structs are decoded from their MessagePack or CBOR payload.
    * @param topic MQTT topic to subscribe. Topic's prefix is prepended.
    * @param qos MQTT qos
    * @param value reference to a value where incoming message will be stored
    * @return std::unique_ptr<Subscription> delete of subscription results in MQTT unsubscribe
    */
-  template<typename T>
+  template<typename T,
+    typename std::enable_if_t<!std::is_invocable_v<T&, const Data&> && !std::is_invocable_v<T&, std::string_view>>* =
+      nullptr>
   std::unique_ptr<Subscription> subscribe(std::string_view topic, Qos qos, T& value) {
-    return subscribe(topic, qos, [&value](std::string_view data) {
+    return _subscribeWhole(topic, qos, Reassembly{_maxSizeOf<T>(), nullptr}, [&value](std::string_view data) {
       if constexpr (std::is_same_v<T, std::string>) {
         value = std::string(data);
       } else {
@@ -158,7 +322,8 @@ struct Mqtt {
   void publish(std::string_view topic, std::string_view data, Qos qos, bool isRetained);
 
   /**
-   * @brief Publish MQTT message
+   * @brief Publish MQTT message. Bool, integral and floating point values are published as text, structs described
+   * by essentials::Fields are encoded into MessagePack or CBOR.
    *
    * @tparam T
    * @param topic
@@ -167,46 +332,277 @@ struct Mqtt {
    * @param isRetained
    */
   template<typename T, typename std::enable_if_t<!std::is_constructible_v<std::string_view, T>>* = nullptr>
-  void publish(std::string_view topic, T value, Qos qos, bool isRetained) {
-    publish(topic, _toString(value), qos, isRetained);
+  void publish(std::string_view topic, const T& value, Qos qos, bool isRetained) {
+    _format(value, [&](std::string_view data) { publish(topic, data, qos, isRetained); });
   }
 
+  /**
+   * @brief Publish MQTT message to a prepared topic without allocations
+   *
+   * @param topic
+   * @param data
+   * @param qos
+   * @param isRetained
+   */
+  void publish(const Topic& topic, std::string_view data, Qos qos, bool isRetained);
+
+  /**
+   * @brief Publish MQTT message to a prepared topic. Value is formatted or encoded into a stack buffer thus publishing
+   * doesn't allocate.
+   *
+   * @tparam T
+   * @param topic
+   * @param value
+   * @param qos
+   * @param isRetained
+   */
+  template<typename T, typename std::enable_if_t<!std::is_constructible_v<std::string_view, T>>* = nullptr>
+  void publish(const Topic& topic, const T& value, Qos qos, bool isRetained) {
+    _format(value, [&](std::string_view data) { publish(topic, data, qos, isRetained); });
+  }
+
+  /**
+   * @brief Keep messages published while disconnected in a queue with a fixed memory budget. Queued messages are sent
+   * in publish order after connection is established, one message per drain interval so reconnect doesn't flood the
+   * network and the client's outbox. Messages are sent by a task created on the first call.
+   *
+   * @param capacity memory budget of the queue in bytes
+   * @param dropPolicy which messages are dropped when the queue is full
+   * @param isCoalesced newer message replaces a queued message to the same topic
+   * @param drainInterval pause between two queued messages
+   */
+  void setOutboundQueue(std::size_t capacity,
+    OutboundQueue::DropPolicy dropPolicy = OutboundQueue::DropPolicy::Oldest,
+    bool isCoalesced = false,
+    std::chrono::milliseconds drainInterval = std::chrono::milliseconds{20});
+
+  /**
+   * @brief Statistics of the outbound queue, all zero if there is no queue
+   */
+  OutboundQueue::Stats outboundStats() const;
+
+  /**
+   * @brief Run subscription reactions on worker threads instead of MQTT client's task, so slow reactions don't delay
+   * keep-alive and other incoming messages. Each message is copied into a preallocated buffer of MQTT buffer size
+   * and posted into a lock-free queue of a worker, messages are dropped when the worker falls behind. A subscription
+   * is always served by the same worker so its reaction is never run concurrently and messages keep their order.
+   * Workers run waiting messages with higher priority first. Can be called only once.
+   *
+   * NOTE destroying a subscription waits until its running reaction returns, thus a reaction can destroy any
+   * subscription, but two reactions must not destroy each other's subscriptions
+   *
+   * @param workerCount number of worker threads
+   * @param queueDepth maximum number of messages waiting for each priority of each worker
+   * @param stackSize stack size of a worker
+   * @param taskPriority FreeRTOS priority of workers
+   */
+  void setDispatchWorkers(
+    std::size_t workerCount = 1, std::size_t queueDepth = 8, std::size_t stackSize = 4096, int taskPriority = 5);
+
+  /**
+   * @brief Statistics of dispatch workers, all zero if reactions run on MQTT client's task
+   */
+  DispatchStats dispatchStats() const;
+
+  /**
+   * @brief Pace subscriptions sent after connect, so reconnect of many devices with many topics doesn't flood
+   * broker. Without pacing all subscriptions are sent at once by MQTT client's task. With pacing the first batch is
+   * sent by MQTT client's task and the rest by a task created on the first call.
+   *
+   * @param batchSize maximum number of SUBSCRIBE packets sent at once, each packet subscribes one topic
+   * @param interval pause between two batches
+   */
+  void setResubscribePacing(
+    std::size_t batchSize = 8, std::chrono::milliseconds interval = std::chrono::milliseconds{50});
+
+  /**
+   * @brief Statistics of connects and subscriptions sent to broker
+   */
+  ReconnectStats reconnectStats() const;
+
+  /**
+   * @brief Limit size of messages reassembled for typed and value subscriptions of strings and described structs, so a
+   * big message doesn't exhaust memory. Bigger messages are dropped (see droppedMessages()). Applies to subscriptions
+   * made afterwards.
+   *
+   * @param maxSize maximum message size, DEFAULT_MAX_MESSAGE_SIZE by default
+   */
+  void setMaxMessageSize(std::size_t maxSize);
+
+  std::size_t maxMessageSize() const;
+
+  /**
+   * @brief Number of messages dropped by subscriptions which reassemble whole messages, because they were too big,
+   * their fragment was missing or buffer pool was exhausted
+   */
+  uint32_t droppedMessages() const;
+
+  /**
+   * @brief Format value into payload as publish() does. Bool, integral and floating point values are formatted as text
+   * and described structs are encoded by their codec into a stack buffer, thus formatting doesn't allocate (except
+   * encoded structs bigger than MAX_STACK_ENCODED_SIZE).
+   *
+   * @param value
+   * @param consumer callback with payload, payload is valid only during the call
+   */
+  template<typename T, typename F>
+  static void format(const T& value, F&& consumer) {
+    _format(value, consumer);
+  }
+
+  /**
+   * @brief Allocate memory of subscriptions in advance, so subscribing doesn't allocate until there are more
+   * subscriptions. Memory of deleted subscriptions is reused by new ones.
+   *
+   * @param count number of subscriptions
+   */
+  static void reserveSubscriptions(std::size_t count);
+
 private:
-  struct Private;
   std::unique_ptr<Private> p;
 
   static constexpr size_t MAX_DIGITS = 64;
+  static constexpr size_t MAX_STACK_ENCODED_SIZE = 256;
+
+  /**
+   * @brief Collects fragments of a message by their offsets into a buffer from a pool or its own buffer
+   */
+  struct Reassembly {
+    std::size_t maxSize;
+    BufferPool* pool;
+    /** @brief Counter of dropped messages of Mqtt */
+    std::atomic<uint32_t>* dropped = nullptr;
+    BufferPool::Buffer pooledBuffer{};
+    std::string ownBuffer{};
+    std::size_t received = 0;
+    bool isReceiving = false;
+
+    /**
+     * @brief Add a fragment, call release() after the whole message is processed
+     *
+     * @return std::optional<std::string_view> whole message once its last fragment arrives
+     */
+    std::optional<std::string_view> append(const Data& data);
+    void release();
 
+  private:
+    bool _start(std::size_t totalLength);
+  };
+
+  /**
+   * @brief Writes fragments of a message by their offsets into a sink
+   */
+  struct Streaming {
+    PayloadSink* sink;
+    Integrity integrity;
+    std::size_t payloadSize = 0;
+    std::size_t received = 0;
+    uint32_t crc = 0;
+    std::array<uint8_t, sizeof(uint32_t)> trailer{};
+    bool isReceiving = false;
+
+    /**
+     * @brief Add a fragment
+     *
+     * @return std::optional<bool> once the message is finished, true when it was committed and false when dropped
+     */
+    std::optional<bool> append(const Data& data);
+
+  private:
+    void _write(std::string_view data);
+    bool _drop(const char* reason);
+  };
+
+  std::unique_ptr<Subscription> _subscribe(std::string_view topic, Qos qos, Reaction reaction);
+  std::atomic<uint32_t>* _droppedCounter() const;
+
+  /**
+   * @brief Subscribe with reassembly of fragmented messages
+   */
+  template<typename F>
+  std::unique_ptr<Subscription> _subscribeWhole(std::string_view topic, Qos qos, Reassembly reassembly, F reaction) {
+    reassembly.dropped = _droppedCounter();
+    return _subscribe(topic,
+      qos,
+      Reaction{[reassembly = std::move(reassembly), reaction = std::move(reaction)](const Data& data) mutable {
+        if (std::optional<std::string_view> message = reassembly.append(data)) {
+          reaction(*message);
+          reassembly.release();
+        }
+      }});
+  }
+
+  /**
+   * @brief Maximum size of message reassembled for typed and value subscriptions of T
+   */
   template<typename T>
-  static std::string _toString(T value) {
+  std::size_t _maxSizeOf() const {
+    if constexpr (std::is_same_v<T, std::string> || isDescribed<T>) return maxMessageSize();
+    return MAX_DIGITS;
+  }
+
+  /**
+   * @brief Format value as text or encode described struct and pass payload to publisher. Payloads up to
+   * MAX_STACK_ENCODED_SIZE are encoded on the stack.
+   */
+  template<typename T, typename Publisher>
+  static void _format(const T& value, Publisher&& publisher) {
+    if constexpr (isDescribed<T>) {
+      std::array<uint8_t, MAX_STACK_ENCODED_SIZE> buffer;
+      const std::size_t size = encode(codecOf<T>, value, MutableSpan<uint8_t>{buffer.data(), buffer.size()});
+      if (size <= buffer.size()) {
+        publisher(std::string_view{reinterpret_cast<const char*>(buffer.data()), size});
+        return;
+      }
+
+      std::vector<uint8_t> bigBuffer(size);
+      encode(codecOf<T>, value, MutableSpan<uint8_t>{bigBuffer.data(), bigBuffer.size()});
+      publisher(std::string_view{reinterpret_cast<const char*>(bigBuffer.data()), size});
+    } else {
+      std::array<char, MAX_DIGITS> buffer;
+      publisher(_toChars(value, buffer));
+    }
+  }
+
+  template<typename T>
+  static std::string_view _toChars(T value, std::array<char, MAX_DIGITS>& buffer) {
     constexpr bool isValidType = std::is_same_v<T, bool> || std::is_integral_v<T> || std::is_floating_point_v<T>;
     static_assert(isValidType, "T must be bool, integral or floating point");
 
     if constexpr (std::is_same_v<T, bool>) {
-      return value ? std::string(TRUE_LITERAL) : std::string(FALSE_LITERAL);
+      return value ? TRUE_LITERAL : FALSE_LITERAL;
     } else if constexpr (std::is_integral_v<T>) {
-      std::array<char, MAX_DIGITS> buffer;
       auto [p, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
-      if (ec != std::errc()) return std::string(NAN_LITERAL);
+      if (ec != std::errc()) return NAN_LITERAL;
 
-      return std::string{buffer.begin(), std::size_t(p - buffer.begin())};
+      return std::string_view{buffer.data(), std::size_t(p - buffer.data())};
     } else if constexpr (std::is_floating_point_v<T>) {
-      if (std::isnan(value)) return std::string(NAN_LITERAL);
+      if (std::isnan(value)) return NAN_LITERAL;
 
-      if (std::isinf(value)) return std::string(value > 0.0 ? POSITIVE_INF_LITERAL : NEGATIVE_INF_LITERAL);
+      if (std::isinf(value)) return value > 0.0 ? POSITIVE_INF_LITERAL : NEGATIVE_INF_LITERAL;
 
-      // TODO use std::to_chars when will be implemented in GCC for floating point types
-      return std::to_string(value);
+      // NOTE long double is formatted as double, they are the same on ESP32
+      using Formatted = std::conditional_t<std::is_same_v<T, float>, float, double>;
+      const std::size_t size = formatFloat(Formatted(value), MutableSpan<char>{buffer.data(), buffer.size()});
+      if (size == 0) return NAN_LITERAL;
+
+      return std::string_view{buffer.data(), size};
     }
     return "";
   }
 
   template<typename T>
   static std::optional<T> _fromString(std::string_view textValue) {
-    constexpr bool isValidType = std::is_same_v<T, bool> || std::is_integral_v<T> || std::is_floating_point_v<T>;
-    static_assert(isValidType, "T must be bool, integral or floating point");
-
-    if constexpr (std::is_same_v<T, bool>) {
+    constexpr bool isValidType =
+      std::is_same_v<T, bool> || std::is_integral_v<T> || std::is_floating_point_v<T> || isDescribed<T>;
+    static_assert(isValidType, "T must be bool, integral, floating point or described struct");
+
+    if constexpr (isDescribed<T>) {
+      T value{};
+      Span<uint8_t> payload{reinterpret_cast<const uint8_t*>(textValue.data()), textValue.size()};
+      if (!decode(codecOf<T>, payload, value)) return std::nullopt;
+      return value;
+    } else if constexpr (std::is_same_v<T, bool>) {
       if (textValue == TRUE_LITERAL) return true;
       else if (textValue == FALSE_LITERAL)
         return false;
@@ -220,7 +616,6 @@ private:
       }
       return value;
     } else if constexpr (std::is_floating_point_v<T>) {
-      std::optional<T> value;
       if (textValue == NAN_LITERAL) return std::numeric_limits<T>::quiet_NaN();
 
       if (textValue == POSITIVE_INF_LITERAL) return std::numeric_limits<T>::infinity();
@@ -228,19 +623,9 @@ private:
       if (textValue == NEGATIVE_INF_LITERAL) return -std::numeric_limits<T>::infinity();
 
       // TODO use std::from_chars when will be implemented in GCC for floating point types
-      try {
-        if constexpr (std::is_same_v<T, float>) {
-          return std::stof(std::string(textValue));
-        }
-        if constexpr (std::is_same_v<T, double>) {
-          return std::stod(std::string(textValue));
-        }
-        if constexpr (std::is_same_v<T, long double>) {
-          return std::stold(std::string(textValue));
-        }
-      } catch (const std::exception&) {
-        return std::nullopt;
-      }
+      T value;
+      if (!parseFloat(textValue, value)) return std::nullopt;
+      return value;
     }
   }
 };
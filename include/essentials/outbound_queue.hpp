@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+namespace essentials {
+
+/**
+ * @brief FIFO of outgoing MQTT messages in a fixed memory budget. Messages are stored one after another in a single
+ * preallocated buffer, space of removed messages is reclaimed by compaction when the buffer end is reached.
+ */
+class OutboundQueue {
+public:
+  /**
+   * @brief Which messages are dropped when a new message doesn't fit. Oldest drops the oldest messages, Newest drops
+   * the new message and LowestQos drops the oldest messages with the lowest QoS which isn't higher than QoS of the new
+   * message.
+   */
+  enum class DropPolicy { Oldest, Newest, LowestQos };
+
+  struct Message {
+    /** @brief NUL-terminated topic */
+    std::string_view topic;
+    std::string_view data;
+    int qos;
+    bool isRetained;
+  };
+
+  struct Stats {
+    uint32_t depth;
+    uint32_t bytes;
+    uint32_t enqueued;
+    uint32_t dropped;
+    /** @brief Messages replaced by a newer message to the same topic */
+    uint32_t coalesced;
+    uint32_t sent;
+  };
+
+  /**
+   * @brief Create queue
+   *
+   * @param capacity memory budget in bytes, each message costs its topic, data and 8 bytes of header
+   * @param dropPolicy
+   * @param isCoalesced newer message to a topic replaces queued message to the same topic
+   */
+  OutboundQueue(std::size_t capacity, DropPolicy dropPolicy, bool isCoalesced);
+  ~OutboundQueue();
+
+  /**
+   * @brief Enqueue copy of a message
+   *
+   * @return true if message was enqueued
+   */
+  bool push(std::string_view topic, std::string_view data, int qos, bool isRetained);
+
+  /**
+   * @brief The oldest message, it stays valid until the queue is changed
+   */
+  std::optional<Message> front() const;
+
+  /**
+   * @brief Remove the oldest message after it was sent
+   */
+  void pop();
+
+  bool empty() const;
+  Stats stats() const;
+
+private:
+  struct Private;
+  std::unique_ptr<Private> p;
+};
+
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "essentials/helpers.hpp"
+
+namespace essentials {
+
+/**
+ * @brief Raw flash-like partition. Erased bytes are 0xFF and write can only clear bits thus a region must be erased
+ * before it is written again. Erase works on whole sectors.
+ */
+struct Partition {
+  virtual ~Partition() = default;
+
+  virtual std::size_t size() const = 0;
+  virtual std::size_t sectorSize() const = 0;
+  virtual void read(std::size_t offset, MutableSpan<uint8_t> buffer) const = 0;
+  virtual void write(std::size_t offset, Span<uint8_t> data) = 0;
+  virtual void erase(std::size_t offset, std::size_t size) = 0;
+};
+
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "essentials/helpers.hpp"
+#include "essentials/partition.hpp"
+#include "essentials/persistent_storage.hpp"
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace essentials {
+
+/**
+ * @brief Destination of a payload which arrives in chunks (eg. MQTT message bigger than MQTT buffer). Chunks are
+ * written in order as they arrive, payload becomes visible only after commit verified it, thus the whole payload is
+ * never held in RAM.
+ */
+struct PayloadSink {
+  virtual ~PayloadSink() = default;
+
+  /**
+   * @brief Start a new payload, unfinished payload is aborted
+   *
+   * @param size total size of payload
+   * @throws std::runtime_error when payload doesn't fit into the sink
+   */
+  virtual void begin(std::size_t size) = 0;
+
+  /**
+   * @brief Write next chunk of payload
+   *
+   * @throws std::runtime_error when chunk exceeds payload size or write fails
+   */
+  virtual void write(Span<uint8_t> chunk) = 0;
+
+  /**
+   * @brief Read back written payload, check it against CRC and make it visible
+   *
+   * @param crc CRC-32 of the whole payload (see crc32)
+   * @throws std::runtime_error when payload is incomplete or written data don't match the CRC
+   */
+  virtual void commit(uint32_t crc) = 0;
+
+  /**
+   * @brief Drop unfinished payload
+   */
+  virtual void abort() = 0;
+};
+
+/**
+ * @brief Sink which writes payload into a raw partition. Payload starts at the beginning of the partition and its
+ * header (size, CRC) is written at the end of the partition on commit. Sectors are erased just before they are
+ * written.
+ *
+ * NOTE partition holds one payload, begin invalidates the committed one. Use two partitions to keep the previous
+ * payload until the new one is committed.
+ */
+struct PartitionSink : PayloadSink {
+  explicit PartitionSink(Partition& partition);
+
+  /**
+   * @brief Maximum payload size
+   */
+  std::size_t capacity() const;
+
+  void begin(std::size_t size) override;
+  void write(Span<uint8_t> chunk) override;
+  void commit(uint32_t crc) override;
+  void abort() override;
+
+  /**
+   * @brief Check committed payload against its CRC
+   *
+   * @return std::optional<std::size_t> size of committed payload or nullopt when there is none or it is corrupted
+   */
+  std::optional<std::size_t> verify() const;
+
+private:
+  struct Header {
+    uint32_t magic;
+    uint32_t size;
+    uint32_t crc;
+    uint32_t headerCrc;
+  };
+
+  static constexpr uint32_t MAGIC = 0x4b4e5350;
+
+  std::size_t _headerOffset() const;
+  std::size_t _headerSector() const;
+  uint32_t _crcOf(std::size_t size) const;
+
+  Partition& _partition;
+  std::size_t _size = 0;
+  std::size_t _written = 0;
+  std::size_t _erasedEnd = 0;
+  bool _isWriting = false;
+};
+
+/**
+ * @brief Sink which writes payload into a PersistentStorage as values of fixed-size chunks and a manifest (size, CRC)
+ * under a given key. RAM is limited to one chunk. Chunks of a new payload are written next to the committed one, thus
+ * the committed payload stays readable until the manifest of the new one is written and the storage keeps up to two
+ * payloads.
+ */
+struct StorageSink : PayloadSink {
+  /**
+   * @brief Maximum length of manifest key, keys of chunks append generation and chunk index to it
+   */
+  static constexpr std::size_t MAX_KEY_LENGTH = StorageKey::MAX_LENGTH - 4;
+  static constexpr std::size_t MAX_CHUNKS = 0x1000;
+
+  /**
+   * @brief Create sink
+   *
+   * @param storage
+   * @param key key of manifest, it has at most MAX_KEY_LENGTH characters
+   * @param chunkSize size of values in storage, payload can have at most MAX_CHUNKS chunks
+   * @throws std::runtime_error when key is too long
+   */
+  StorageSink(PersistentStorage& storage, std::string_view key, std::size_t chunkSize = 1024);
+
+  void begin(std::size_t size) override;
+  void write(Span<uint8_t> chunk) override;
+  void commit(uint32_t crc) override;
+  void abort() override;
+
+  /**
+   * @brief Check committed payload against its CRC
+   *
+   * @return std::optional<std::size_t> size of committed payload or nullopt when there is none or it is corrupted
+   */
+  std::optional<std::size_t> verify() const;
+
+  /**
+   * @brief Read committed payload chunk by chunk
+   *
+   * @param consumer gets chunks in order
+   * @return bool false when there is no payload or it is corrupted, consumer should discard chunks it got
+   */
+  bool read(const std::function<void(Span<uint8_t>)>& consumer) const;
+
+private:
+  struct Manifest {
+    uint32_t magic;
+    uint32_t size;
+    uint32_t chunkSize;
+    uint32_t crc;
+    uint32_t generation;
+  };
+
+  static constexpr uint32_t MAGIC = 0x4b4e5353;
+
+  std::optional<Manifest> _manifest() const;
+  StorageKey _chunkKey(uint32_t generation, std::size_t index) const;
+  void _writeChunk();
+
+  PersistentStorage& _storage;
+  StorageKey _key;
+  std::size_t _chunkSize;
+  std::vector<uint8_t> _buffer{};
+  std::size_t _size = 0;
+  std::size_t _written = 0;
+  uint32_t _generation = 0;
+  bool _isWriting = false;
+};
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace essentials {
+
+/**
+ * @brief Task which runs a callback periodically while it is started. Unlike esp_timer callbacks, which all run on one
+ * shared esp_timer task, the callback can block (eg. on network I/O) without delaying other timers of the system.
+ */
+class PeriodicTask {
+public:
+  /**
+   * @brief Create stopped task
+   *
+   * @param callback called every interval on the task, it returns false to stop the task unless start() was called
+   * meanwhile
+   * @param name task name
+   * @param stackSize
+   * @param priority FreeRTOS priority
+   */
+  PeriodicTask(std::function<bool()> callback, const char* name, std::size_t stackSize = 4096, int priority = 5);
+
+  /**
+   * @brief Stop the task and wait for running callback, must not be called from the callback
+   */
+  ~PeriodicTask();
+
+  /**
+   * @brief Run callback every interval, the first run is after interval. Started task is restarted.
+   */
+  void start(std::chrono::milliseconds interval);
+
+  /**
+   * @brief Stop running callback, callback which is running finishes
+   */
+  void stop();
+
+private:
+  struct Private;
+  std::unique_ptr<Private> p;
+};
+
+}
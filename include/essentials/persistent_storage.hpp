@@ -1,19 +1,91 @@
 #pragma once
 
 #include "essentials/helpers.hpp"
+#include "essentials/storage_key.hpp"
 
-#include <string_view>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
 #include <vector>
 
 namespace essentials {
 
 struct PersistentStorage {
+  struct Entry {
+    StorageKey key;
+    Span<uint8_t> data;
+  };
+
   virtual ~PersistentStorage() = default;
 
-  virtual int size(std::string_view key) const = 0;
-  virtual std::vector<uint8_t> read(std::string_view key, int size) const = 0;
-  virtual void write(std::string_view key, Span<uint8_t> data) = 0;
+  virtual int size(const StorageKey& key) const = 0;
+  virtual std::vector<uint8_t> read(const StorageKey& key, int size) const = 0;
+  virtual void write(const StorageKey& key, Span<uint8_t> data) = 0;
   virtual void clear() = 0;
+
+  /**
+   * @brief Read data into a given buffer with a single storage lookup
+   *
+   * @param key
+   * @param buffer
+   * @return int size of stored data or -1 if there is no data for the key. When returned size is bigger than buffer
+   * size, buffer is left untouched and read has to be repeated with a buffer of returned size.
+   */
+  virtual int readInto(const StorageKey& key, MutableSpan<uint8_t> buffer) const {
+    int storedSize = size(key);
+    if (storedSize < 0 || storedSize > int(buffer.size)) return storedSize;
+
+    std::vector<uint8_t> data = read(key, storedSize);
+    std::copy(data.begin(), data.end(), buffer.data);
+    return storedSize;
+  }
+
+  /**
+   * @brief Write multiple entries at once. Storages with explicit commit should commit only once per batch.
+   */
+  virtual void writeBatch(Span<Entry> entries) {
+    for (std::size_t i = 0; i < entries.size; i++) {
+      write(entries.data[i].key, entries.data[i].data);
+    }
+  }
+
+  /**
+   * @brief Keys of all stored values
+   *
+   * @throws std::runtime_error when storage can't enumerate its keys
+   */
+  virtual std::vector<StorageKey> keys() const {
+    throw std::runtime_error("storage doesn't support key enumeration");
+  }
+
+  /**
+   * @brief Write out all staged data. Storages which don't stage writes have nothing to flush.
+   */
+  virtual void flush() {
+  }
+
+  /**
+   * @brief Begin transaction. All writes until commit are applied atomically. Storages without transaction support
+   * apply writes immediately.
+   */
+  virtual void begin() {
+  }
+
+  /**
+   * @brief Apply all writes since begin atomically. Storages without transaction support only flush.
+   */
+  virtual void commit() {
+    flush();
+  }
+
+  /**
+   * @brief Discard all writes since begin
+   *
+   * @throws std::runtime_error when storage doesn't support transactions
+   */
+  virtual void rollback() {
+    throw std::runtime_error("storage doesn't support transactions");
+  }
 };
 
 }
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "essentials/persistent_storage.hpp"
+
+#include <vector>
+
+namespace essentials {
+
+/**
+ * @brief Export all values of a storage (e.g. one Esp32Storage namespace) into a compact binary snapshot.
+ *
+ * Snapshot: [magic u32] [format version u8] [flags u8] [entry count varint]
+ * ([key size u8] [key] [data size varint] [data])... [crc32 u32]
+ *
+ * @param storage storage which supports key enumeration
+ * @return std::vector<uint8_t>
+ */
+std::vector<uint8_t> exportSnapshot(const PersistentStorage& storage);
+
+/**
+ * @brief Export only values which are missing in base snapshot or differ from it. Keys removed since base snapshot
+ * aren't recorded.
+ *
+ * @param storage storage which supports key enumeration
+ * @param base snapshot previously exported from this or other storage
+ * @return std::vector<uint8_t>
+ */
+std::vector<uint8_t> exportSnapshot(const PersistentStorage& storage, Span<uint8_t> base);
+
+/**
+ * @brief Write all values of a full or delta snapshot in one transaction (see PersistentStorage::begin). Snapshot is
+ * validated before anything is written. Configs on top of the storage have to be reloaded afterwards.
+ *
+ * @param storage
+ * @param snapshot
+ * @return std::size_t number of imported values
+ * @throws std::runtime_error when snapshot is malformed or corrupted
+ */
+std::size_t importSnapshot(PersistentStorage& storage, Span<uint8_t> snapshot);
+
+}
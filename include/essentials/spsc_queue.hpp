@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace essentials {
+
+/**
+ * @brief Bounded lock-free queue for one producer and one consumer. Items live in a ring allocated once, producer
+ * only moves the tail and consumer only moves the head thus neither of them ever blocks.
+ *
+ * @tparam T default constructible and move assignable item
+ */
+template<typename T>
+class SpscQueue {
+public:
+  explicit SpscQueue(std::size_t capacity) : _slotCount(capacity + 1), _slots(std::make_unique<T[]>(capacity + 1)) {
+  }
+
+  /**
+   * @brief Called only by the producer
+   *
+   * @return false if the queue is full, item isn't moved then
+   */
+  bool push(T&& item) {
+    const std::size_t tail = _tail.load(std::memory_order_relaxed);
+    const std::size_t next = _next(tail);
+    if (next == _head.load(std::memory_order_acquire)) return false;
+
+    _slots[tail] = std::move(item);
+    _tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Called only by the consumer
+   *
+   * @return false if the queue is empty
+   */
+  bool pop(T& item) {
+    const std::size_t head = _head.load(std::memory_order_relaxed);
+    if (head == _tail.load(std::memory_order_acquire)) return false;
+
+    item = std::move(_slots[head]);
+    _head.store(_next(head), std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Number of items, it is exact only when called by the producer or the consumer
+   */
+  std::size_t size() const {
+    const std::size_t head = _head.load(std::memory_order_acquire);
+    const std::size_t tail = _tail.load(std::memory_order_acquire);
+    return tail >= head ? tail - head : _slotCount - head + tail;
+  }
+
+  bool empty() const {
+    return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+  }
+
+  std::size_t capacity() const {
+    return _slotCount - 1;
+  }
+
+private:
+  // NOTE one slot always stays free to distinguish full queue from empty one
+  std::size_t _slotCount;
+  std::unique_ptr<T[]> _slots;
+  std::atomic<std::size_t> _head{0};
+  std::atomic<std::size_t> _tail{0};
+
+  std::size_t _next(std::size_t index) const {
+    return index + 1 == _slotCount ? 0 : index + 1;
+  }
+};
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+namespace essentials {
+
+/**
+ * @brief NUL-terminated key of PersistentStorage stored inline. Length of a key created from string literal is
+ * checked at compile time against NVS key length limit. Hash of the key is precomputed for in-RAM lookups.
+ */
+class StorageKey {
+public:
+  static constexpr std::size_t MAX_LENGTH = 15;
+
+  struct Hash {
+    constexpr std::size_t operator()(const StorageKey& key) const {
+      return key._hash;
+    }
+  };
+
+  template<std::size_t N>
+  constexpr StorageKey(const char (&key)[N]) : StorageKey(std::string_view{key, N - 1}) {
+    static_assert(N - 1 <= MAX_LENGTH, "storage key is too long, NVS allows 15 characters at most");
+  }
+
+  /**
+   * @brief Create key from runtime string
+   *
+   * @param key
+   * @throws std::runtime_error when key is longer than MAX_LENGTH
+   */
+  constexpr explicit StorageKey(std::string_view key) : _size(key.size()) {
+    if (key.size() > MAX_LENGTH) throw std::runtime_error("storage key is too long");
+
+    uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < key.size(); i++) {
+      _data[i] = key[i];
+      hash = (hash ^ uint8_t(key[i])) * 16777619u;
+    }
+    _hash = hash;
+  }
+
+  constexpr const char* c_str() const {
+    return _data.data();
+  }
+
+  constexpr std::string_view view() const {
+    return {_data.data(), _size};
+  }
+
+  constexpr uint32_t hash() const {
+    return _hash;
+  }
+
+  constexpr bool operator==(const StorageKey& other) const {
+    return _hash == other._hash && view() == other.view();
+  }
+
+  constexpr bool operator!=(const StorageKey& other) const {
+    return !(*this == other);
+  }
+
+private:
+  std::array<char, MAX_LENGTH + 1> _data{};
+  std::size_t _size = 0;
+  uint32_t _hash = 0;
+};
+
+}
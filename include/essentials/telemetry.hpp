@@ -0,0 +1,99 @@
+#pragma once
+
+#include "essentials/mqtt.hpp"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+namespace essentials {
+
+/**
+ * @brief Batches values of named metrics into one MQTT message. Metrics updated since last flush are published on
+ * the interval or as soon as the payload would exceed its maximum size. Payload is a JSON object or MessagePack map
+ * of metric names to values, payload bigger than maximum size is split into multiple messages.
+ */
+struct Telemetry {
+  enum class Format { Json, MessagePack };
+
+  using Value = std::variant<bool, int64_t, double>;
+
+  struct Stats {
+    uint32_t messages;
+    uint32_t values;
+    uint32_t bytes;
+  };
+
+  /**
+   * @brief Create telemetry publishing into one topic
+   *
+   * @param mqtt
+   * @param topic MQTT topic of batched messages. Mqtt's topic prefix is prepended.
+   * @param interval
+   * @param format
+   * @param maxPayloadSize maximum size of a batched message including JSON braces or MessagePack map header, values
+   * are split into more messages to fit, a value which doesn't fit alone is published in its own message
+   * @param isPublishedPerMetric publish each value also to its own topic '<topic>/<metric name>' as text
+   */
+  Telemetry(Mqtt& mqtt,
+    std::string_view topic,
+    std::chrono::milliseconds interval = std::chrono::milliseconds{1000},
+    Format format = Format::Json,
+    std::size_t maxPayloadSize = 512,
+    bool isPublishedPerMetric = false);
+  ~Telemetry();
+
+  /**
+   * @brief Set value of a metric, metric is registered by its first value
+   *
+   * @tparam T bool, integral or floating point type
+   * @param name
+   * @param value
+   */
+  template<typename T>
+  void set(std::string_view name, T value) {
+    _set(name, _toValue(value));
+  }
+
+  /**
+   * @brief Register metric whose value is sampled on every flush
+   *
+   * @param name
+   * @param sampler function returning bool, integral or floating point value
+   */
+  template<typename Sampler>
+  void sample(std::string_view name, Sampler sampler) {
+    _sample(name, [sampler]() { return _toValue(sampler()); });
+  }
+
+  /**
+   * @brief Publish updated and sampled metrics now
+   */
+  void flush();
+
+  Stats stats() const;
+
+private:
+  struct Private;
+  std::unique_ptr<Private> p;
+
+  template<typename T>
+  static Value _toValue(T value) {
+    static_assert(std::is_arithmetic_v<T>, "T must be bool, integral or floating point");
+    if constexpr (std::is_same_v<T, bool>) {
+      return Value{value};
+    } else if constexpr (std::is_floating_point_v<T>) {
+      return Value{double(value)};
+    } else {
+      return Value{int64_t(value)};
+    }
+  }
+
+  void _set(std::string_view name, Value value);
+  void _sample(std::string_view name, std::function<Value()> sampler);
+};
+
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace essentials {
+
+/**
+ * @brief MQTT topic filters organized by topic levels. Supports single-level '+' and multi-level '#' wildcards.
+ * Matching walks only levels of a given topic thus its cost doesn't grow with number of unrelated filters and it
+ * doesn't allocate.
+ *
+ * @tparam T value stored with a filter
+ */
+template<typename T>
+class TopicTrie {
+public:
+  /**
+   * @brief Add value for a topic filter
+   *
+   * @param filter topic filter, '+' and '#' must occupy whole level and '#' must be the last level
+   * @param value
+   */
+  void insert(std::string_view filter, T value) {
+    _forEachLevel(filter, [](std::string_view level, bool isLast) {
+      if (level == "#" && !isLast) throw std::runtime_error("multi-level wildcard must be the last topic level");
+      if (level != "#" && level != "+" && level.find_first_of("+#") != std::string_view::npos) {
+        throw std::runtime_error("wildcard must occupy whole topic level");
+      }
+    });
+
+    Node* node = &_root;
+    _forEachLevel(filter, [&node](std::string_view level, bool) {
+      if (level == "#") return;
+
+      std::unique_ptr<Node>& child = level == "+" ? node->singleLevel : node->children[std::string(level)];
+      if (!child) child = std::make_unique<Node>();
+      node = child.get();
+    });
+
+    _valuesOf(*node, filter).push_back(std::move(value));
+    _size++;
+  }
+
+  /**
+   * @brief Remove one value of a topic filter
+   *
+   * @return true if value was found
+   */
+  bool erase(std::string_view filter, const T& value) {
+    const bool isErased = _erase(_root, filter, 0, value);
+    if (isErased) _size--;
+    return isErased;
+  }
+
+  /**
+   * @brief Call callback with every value whose filter matches a topic. Wildcards don't match topics starting with
+   * '$' at the first level.
+   */
+  template<typename Callback>
+  void match(std::string_view topic, Callback&& callback) const {
+    _match(_root, topic, 0, callback);
+  }
+
+  /**
+   * @brief Call callback with every stored value
+   */
+  template<typename Callback>
+  void forEach(Callback&& callback) const {
+    _forEach(_root, callback);
+  }
+
+  std::size_t size() const {
+    return _size;
+  }
+
+  bool empty() const {
+    return _size == 0;
+  }
+
+private:
+  struct Node {
+    // NOTE std::less<> allows lookup by std::string_view without creating std::string
+    std::map<std::string, std::unique_ptr<Node>, std::less<>> children{};
+    std::unique_ptr<Node> singleLevel{};
+    std::vector<T> values{};
+    std::vector<T> multiLevelValues{};
+
+    bool empty() const {
+      return children.empty() && !singleLevel && values.empty() && multiLevelValues.empty();
+    }
+  };
+
+  Node _root{};
+  std::size_t _size = 0;
+
+  template<typename Callback>
+  static void _forEachLevel(std::string_view topic, Callback&& callback) {
+    std::size_t begin = 0;
+    while (true) {
+      const std::size_t end = std::min(topic.find('/', begin), topic.size());
+      const bool isLast = end == topic.size();
+      callback(topic.substr(begin, end - begin), isLast);
+      if (isLast) return;
+      begin = end + 1;
+    }
+  }
+
+  static std::vector<T>& _valuesOf(Node& node, std::string_view filter) {
+    const bool isMultiLevel = filter == "#" || (filter.size() >= 2 && filter.substr(filter.size() - 2) == "/#");
+    return isMultiLevel ? node.multiLevelValues : node.values;
+  }
+
+  static bool _eraseValue(std::vector<T>& values, const T& value) {
+    auto it = std::find(values.begin(), values.end(), value);
+    if (it == values.end()) return false;
+    values.erase(it);
+    return true;
+  }
+
+  /**
+   * @brief Erase value from a subtree and prune nodes which became empty
+   */
+  static bool _erase(Node& node, std::string_view filter, std::size_t begin, const T& value) {
+    const std::size_t end = std::min(filter.find('/', begin), filter.size());
+    const std::string_view level = filter.substr(begin, end - begin);
+    if (level == "#") return _eraseValue(node.multiLevelValues, value);
+
+    std::unique_ptr<Node>* child = &node.singleLevel;
+    auto it = node.children.end();
+    if (level != "+") {
+      it = node.children.find(level);
+      if (it == node.children.end()) return false;
+      child = &it->second;
+    }
+    if (!*child) return false;
+
+    const bool isErased =
+      end == filter.size() ? _eraseValue((*child)->values, value) : _erase(**child, filter, end + 1, value);
+    if (isErased && (*child)->empty()) {
+      if (it != node.children.end()) {
+        node.children.erase(it);
+      } else {
+        child->reset();
+      }
+    }
+    return isErased;
+  }
+
+  template<typename Callback>
+  static void _match(const Node& node, std::string_view topic, std::size_t begin, Callback& callback) {
+    if (begin > topic.size()) {
+      // NOTE all levels are matched, 'a/#' matches also 'a'
+      for (const T& value : node.values) callback(value);
+      for (const T& value : node.multiLevelValues) callback(value);
+      return;
+    }
+
+    // NOTE topics such as '$SYS/...' aren't matched by wildcards at the first level
+    const bool isWildcardAllowed = begin > 0 || topic.empty() || topic[0] != '$';
+    if (isWildcardAllowed) {
+      for (const T& value : node.multiLevelValues) callback(value);
+    }
+
+    const std::size_t end = std::min(topic.find('/', begin), topic.size());
+    auto it = node.children.find(topic.substr(begin, end - begin));
+    if (it != node.children.end()) _match(*it->second, topic, end + 1, callback);
+    if (isWildcardAllowed && node.singleLevel) _match(*node.singleLevel, topic, end + 1, callback);
+  }
+
+  template<typename Callback>
+  static void _forEach(const Node& node, Callback& callback) {
+    for (const T& value : node.values) callback(value);
+    for (const T& value : node.multiLevelValues) callback(value);
+    for (const auto& [level, child] : node.children) _forEach(*child, callback);
+    if (node.singleLevel) _forEach(*node.singleLevel, callback);
+  }
+};
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "essentials/persistent_storage.hpp"
+
+#include <chrono>
+#include <memory>
+
+namespace essentials {
+
+/**
+ * @brief Storage which limits flash wear of underlying storage. Writes of data identical to stored data are skipped.
+ * Writes over budget are deferred in RAM (merged per key) and written as one batch when budget allows it again.
+ * Reads see deferred data.
+ */
+struct WearManagedStorage : PersistentStorage {
+  /**
+   * @brief Write rate budget. Budget refills continuously and unused budget accumulates up to writes. Batch write
+   * consumes budget of one write.
+   */
+  struct Budget {
+    uint32_t writes;
+    std::chrono::milliseconds period;
+  };
+
+  struct Stats {
+    uint32_t writes;
+    /** @brief Writes skipped because data were identical to stored data */
+    uint32_t skipped;
+    /** @brief Deferred writes replaced by newer write of the same key before they were written */
+    uint32_t coalesced;
+    /** @brief Number of keys currently waiting for budget */
+    uint32_t deferred;
+  };
+
+  struct KeyStats {
+    StorageKey key;
+    uint32_t writes;
+    uint32_t skipped;
+    uint32_t coalesced;
+  };
+
+  /**
+   * @brief Create wear managed storage on top of other storage
+   *
+   * @param storage underlying storage
+   * @param budget by default 10 writes per minute
+   */
+  explicit WearManagedStorage(
+    PersistentStorage& storage, Budget budget = Budget{10, std::chrono::milliseconds{60 * 1000}});
+  ~WearManagedStorage();
+
+  int size(const StorageKey& key) const override;
+  std::vector<uint8_t> read(const StorageKey& key, int size) const override;
+  int readInto(const StorageKey& key, MutableSpan<uint8_t> buffer) const override;
+  void write(const StorageKey& key, Span<uint8_t> data) override;
+  void writeBatch(Span<Entry> entries) override;
+  void clear() override;
+  std::vector<StorageKey> keys() const override;
+
+  /**
+   * @brief Write deferred data regardless of budget
+   */
+  void flush() override;
+
+  /**
+   * @brief Begin transaction of underlying storage. Writes in transaction aren't deferred, commit consumes budget of
+   * one write.
+   */
+  void begin() override;
+  void commit() override;
+  void rollback() override;
+
+  Stats stats() const;
+
+  /**
+   * @brief Statistics of all written keys sorted by number of writes, the most worn keys first
+   */
+  std::vector<KeyStats> keyStats() const;
+
+private:
+  struct Private;
+  std::unique_ptr<Private> p;
+};
+
+}
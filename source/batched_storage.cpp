@@ -0,0 +1,219 @@
+#include "essentials/batched_storage.hpp"
+
+#include "essentials/periodic_task.hpp"
+
+#include "esp_log.h"
+
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace essentials {
+
+const char* TAG_BATCHED_STORAGE = "batched_storage";
+
+struct BatchedStorage::Private {
+  PersistentStorage& storage;
+  std::chrono::milliseconds flushDeadline;
+  mutable std::mutex mutex{};
+  std::unordered_map<StorageKey, std::vector<uint8_t>, StorageKey::Hash> staged{};
+  std::optional<std::unordered_map<StorageKey, std::vector<uint8_t>, StorageKey::Hash>> transaction{};
+  // NOTE flash writes of the deadline flush don't run on the shared esp_timer task, the task is the last member thus
+  // it stops before the staged writes it flushes are destroyed
+  PeriodicTask deadlineTask{[this]() { return onDeadline(); }, TAG_BATCHED_STORAGE};
+
+  Private(PersistentStorage& storage, std::chrono::milliseconds flushDeadline) :
+    storage(storage), flushDeadline(flushDeadline) {
+  }
+
+  ~Private() {
+    deadlineTask.stop();
+    try {
+      flush();
+    } catch (const std::exception& e) {
+      ESP_LOGE(TAG_BATCHED_STORAGE, "couldn't flush staged writes: %s", e.what());
+    }
+  }
+
+  bool onDeadline() {
+    try {
+      flush();
+    } catch (const std::exception& e) {
+      ESP_LOGE(TAG_BATCHED_STORAGE, "couldn't flush staged writes: %s", e.what());
+    }
+    // NOTE failed flush re-arms the deadline itself
+    return false;
+  }
+
+  const std::vector<uint8_t>* find(const StorageKey& key) const {
+    if (transaction) {
+      auto it = transaction->find(key);
+      if (it != transaction->end()) return &it->second;
+    }
+    auto it = staged.find(key);
+    if (it != staged.end()) return &it->second;
+    return nullptr;
+  }
+
+  void write(const StorageKey& key, Span<uint8_t> data) {
+    std::lock_guard lock{mutex};
+    if (transaction) {
+      (*transaction)[key].assign(data.data, data.data + data.size);
+      return;
+    }
+    if (staged.empty()) deadlineTask.start(flushDeadline);
+
+    std::vector<uint8_t>& stagedData = staged[key];
+    stagedData.assign(data.data, data.data + data.size);
+  }
+
+  void flush() {
+    std::lock_guard lock{mutex};
+    if (staged.empty()) return;
+
+    deadlineTask.stop();
+
+    std::vector<Entry> entries;
+    entries.reserve(staged.size());
+    for (const auto& [key, data] : staged) {
+      entries.push_back(Entry{key, Span<uint8_t>{data.data(), data.size()}});
+    }
+    try {
+      storage.writeBatch(Span<Entry>{entries.data(), entries.size()});
+    } catch (...) {
+      // NOTE writes stay staged, deadline is re-armed so they are retried even without further writes
+      deadlineTask.start(flushDeadline);
+      throw;
+    }
+    staged.clear();
+  }
+
+  void commit(const std::unordered_map<StorageKey, std::vector<uint8_t>, StorageKey::Hash>& changes) {
+    std::vector<Entry> entries;
+    entries.reserve(changes.size());
+    for (const auto& [key, data] : changes) {
+      entries.push_back(Entry{key, Span<uint8_t>{data.data(), data.size()}});
+    }
+
+    storage.begin();
+    try {
+      storage.writeBatch(Span<Entry>{entries.data(), entries.size()});
+      storage.commit();
+    } catch (...) {
+      try {
+        storage.rollback();
+      } catch (const std::exception& e) {
+        ESP_LOGE(TAG_BATCHED_STORAGE, "couldn't rollback transaction: %s", e.what());
+      }
+      throw;
+    }
+  }
+};
+
+BatchedStorage::BatchedStorage(PersistentStorage& storage, std::chrono::milliseconds flushDeadline) :
+  p(std::make_unique<Private>(storage, flushDeadline)) {
+}
+
+BatchedStorage::~BatchedStorage() = default;
+
+int BatchedStorage::size(const StorageKey& key) const {
+  {
+    std::lock_guard lock{p->mutex};
+    if (const auto* data = p->find(key)) return data->size();
+  }
+  return p->storage.size(key);
+}
+
+std::vector<uint8_t> BatchedStorage::read(const StorageKey& key, int size) const {
+  {
+    std::lock_guard lock{p->mutex};
+    if (const auto* data = p->find(key)) {
+      if (int(data->size()) > size) {
+        throw std::runtime_error("staged data is bigger than requested size");
+      }
+      std::vector<uint8_t> buffer = *data;
+      buffer.resize(size);
+      return buffer;
+    }
+  }
+  return p->storage.read(key, size);
+}
+
+int BatchedStorage::readInto(const StorageKey& key, MutableSpan<uint8_t> buffer) const {
+  {
+    std::lock_guard lock{p->mutex};
+    if (const auto* data = p->find(key)) {
+      if (data->size() <= buffer.size) {
+        std::copy(data->begin(), data->end(), buffer.data);
+      }
+      return data->size();
+    }
+  }
+  return p->storage.readInto(key, buffer);
+}
+
+void BatchedStorage::write(const StorageKey& key, Span<uint8_t> data) {
+  p->write(key, data);
+}
+
+void BatchedStorage::clear() {
+  {
+    std::lock_guard lock{p->mutex};
+    p->deadlineTask.stop();
+    p->staged.clear();
+    p->transaction.reset();
+  }
+  p->storage.clear();
+}
+
+std::vector<StorageKey> BatchedStorage::keys() const {
+  std::vector<StorageKey> keys = p->storage.keys();
+  std::lock_guard lock{p->mutex};
+  auto addKeys = [&keys](const auto& changes) {
+    for (const auto& [key, data] : changes) {
+      if (std::find(keys.begin(), keys.end(), key) == keys.end()) keys.push_back(key);
+    }
+  };
+  addKeys(p->staged);
+  if (p->transaction) addKeys(*p->transaction);
+  return keys;
+}
+
+void BatchedStorage::flush() {
+  p->flush();
+}
+
+void BatchedStorage::begin() {
+  std::lock_guard lock{p->mutex};
+  if (p->transaction) {
+    throw std::runtime_error("transaction is already running");
+  }
+  p->transaction.emplace();
+}
+
+void BatchedStorage::commit() {
+  // NOTE writes staged before the transaction are flushed first so transaction is applied on top of them
+  p->flush();
+
+  std::lock_guard lock{p->mutex};
+  if (!p->transaction) {
+    throw std::runtime_error("there is no transaction to commit");
+  }
+  auto transaction = std::move(*p->transaction);
+  p->transaction.reset();
+  if (!transaction.empty()) p->commit(transaction);
+}
+
+void BatchedStorage::rollback() {
+  std::lock_guard lock{p->mutex};
+  p->transaction.reset();
+}
+
+std::size_t BatchedStorage::stagedCount() const {
+  std::lock_guard lock{p->mutex};
+  return p->staged.size();
+}
+
+}
@@ -0,0 +1,402 @@
+#include "essentials/codec.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace essentials {
+
+// NOTE CBOR major types
+static constexpr uint8_t CBOR_UNSIGNED = 0;
+static constexpr uint8_t CBOR_NEGATIVE = 1;
+static constexpr uint8_t CBOR_BYTES = 2;
+static constexpr uint8_t CBOR_TEXT = 3;
+static constexpr uint8_t CBOR_ARRAY = 4;
+static constexpr uint8_t CBOR_MAP = 5;
+static constexpr uint8_t CBOR_SIMPLE = 7;
+
+void Encoder::writeBool(bool value) {
+  if (_codec == Codec::MessagePack) {
+    _write(value ? 0xc3 : 0xc2);
+  } else {
+    _write(value ? 0xf5 : 0xf4);
+  }
+}
+
+void Encoder::writeInteger(int64_t value) {
+  if (value >= 0) {
+    writeUnsigned(value);
+    return;
+  }
+
+  if (_codec == Codec::Cbor) {
+    // NOTE negative integer n is encoded as -1 - n
+    _writeCborHead(CBOR_NEGATIVE, uint64_t(-(value + 1)));
+    return;
+  }
+
+  if (value >= -32) {
+    // NOTE negative fixint
+    _write(uint8_t(value));
+  } else if (value >= INT8_MIN) {
+    _write(0xd0);
+    _writeBigEndian(uint64_t(value), 1);
+  } else if (value >= INT16_MIN) {
+    _write(0xd1);
+    _writeBigEndian(uint64_t(value), 2);
+  } else if (value >= INT32_MIN) {
+    _write(0xd2);
+    _writeBigEndian(uint64_t(value), 4);
+  } else {
+    _write(0xd3);
+    _writeBigEndian(uint64_t(value), 8);
+  }
+}
+
+void Encoder::writeUnsigned(uint64_t value) {
+  if (_codec == Codec::Cbor) {
+    _writeCborHead(CBOR_UNSIGNED, value);
+    return;
+  }
+
+  if (value < 128) {
+    // NOTE positive fixint
+    _write(uint8_t(value));
+  } else if (value <= UINT8_MAX) {
+    _write(0xcc);
+    _writeBigEndian(value, 1);
+  } else if (value <= UINT16_MAX) {
+    _write(0xcd);
+    _writeBigEndian(value, 2);
+  } else if (value <= UINT32_MAX) {
+    _write(0xce);
+    _writeBigEndian(value, 4);
+  } else {
+    _write(0xcf);
+    _writeBigEndian(value, 8);
+  }
+}
+
+void Encoder::writeFloat(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  _write(_codec == Codec::MessagePack ? 0xca : 0xfa);
+  _writeBigEndian(bits, 4);
+}
+
+void Encoder::writeDouble(double value) {
+  const float narrowed = float(value);
+  if (double(narrowed) == value || std::isnan(value)) {
+    writeFloat(narrowed);
+    return;
+  }
+
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  _write(_codec == Codec::MessagePack ? 0xcb : 0xfb);
+  _writeBigEndian(bits, 8);
+}
+
+void Encoder::writeString(std::string_view value) {
+  if (_codec == Codec::Cbor) {
+    _writeCborHead(CBOR_TEXT, value.size());
+  } else if (value.size() < 32) {
+    _write(uint8_t(0xa0 | value.size()));
+  } else if (value.size() <= UINT8_MAX) {
+    _write(0xd9);
+    _writeBigEndian(value.size(), 1);
+  } else if (value.size() <= UINT16_MAX) {
+    _write(0xda);
+    _writeBigEndian(value.size(), 2);
+  } else {
+    _write(0xdb);
+    _writeBigEndian(value.size(), 4);
+  }
+  _writeBytes(value.data(), value.size());
+}
+
+void Encoder::writeArrayHeader(std::size_t count) {
+  if (_codec == Codec::Cbor) {
+    _writeCborHead(CBOR_ARRAY, count);
+  } else if (count < 16) {
+    _write(uint8_t(0x90 | count));
+  } else if (count <= UINT16_MAX) {
+    _write(0xdc);
+    _writeBigEndian(count, 2);
+  } else {
+    _write(0xdd);
+    _writeBigEndian(count, 4);
+  }
+}
+
+void Encoder::writeMapHeader(std::size_t count) {
+  if (_codec == Codec::Cbor) {
+    _writeCborHead(CBOR_MAP, count);
+  } else if (count < 16) {
+    _write(uint8_t(0x80 | count));
+  } else if (count <= UINT16_MAX) {
+    _write(0xde);
+    _writeBigEndian(count, 2);
+  } else {
+    _write(0xdf);
+    _writeBigEndian(count, 4);
+  }
+}
+
+void Encoder::_write(uint8_t byte) {
+  if (_position < _buffer.size) _buffer.data[_position] = byte;
+  _position++;
+}
+
+void Encoder::_writeBigEndian(uint64_t value, int size) {
+  for (int i = size - 1; i >= 0; i--) {
+    _write(uint8_t(value >> (8 * i)));
+  }
+}
+
+void Encoder::_writeBytes(const void* data, std::size_t size) {
+  if (_position < _buffer.size && _buffer.size - _position >= size) {
+    std::memcpy(_buffer.data + _position, data, size);
+  }
+  _position += size;
+}
+
+void Encoder::_writeCborHead(uint8_t majorType, uint64_t value) {
+  const uint8_t type = majorType << 5;
+  if (value < 24) {
+    _write(type | uint8_t(value));
+  } else if (value <= UINT8_MAX) {
+    _write(type | 24);
+    _writeBigEndian(value, 1);
+  } else if (value <= UINT16_MAX) {
+    _write(type | 25);
+    _writeBigEndian(value, 2);
+  } else if (value <= UINT32_MAX) {
+    _write(type | 26);
+    _writeBigEndian(value, 4);
+  } else {
+    _write(type | 27);
+    _writeBigEndian(value, 8);
+  }
+}
+
+bool Decoder::next(Item& item) {
+  item = Item{};
+  return _codec == Codec::MessagePack ? _nextMessagePack(item) : _nextCbor(item);
+}
+
+bool Decoder::skip(const Item& item) {
+  if (item.type != Item::Type::Array && item.type != Item::Type::Map) return true;
+  // NOTE nesting is limited so malformed payload can't exhaust the stack
+  if (_depth >= MAX_DEPTH) return false;
+
+  _depth++;
+  const uint64_t count = item.type == Item::Type::Map ? 2 * item.unsignedValue : item.unsignedValue;
+  bool isSkipped = true;
+  for (uint64_t i = 0; i < count && isSkipped; i++) {
+    Item nested;
+    isSkipped = next(nested) && skip(nested);
+  }
+  _depth--;
+  return isSkipped;
+}
+
+bool Decoder::_read(uint8_t& byte) {
+  if (_position >= _payload.size) return false;
+  byte = _payload.data[_position++];
+  return true;
+}
+
+bool Decoder::_readBigEndian(uint64_t& value, int size) {
+  if (_payload.size - _position < std::size_t(size)) return false;
+  value = 0;
+  for (int i = 0; i < size; i++) {
+    value = (value << 8) | _payload.data[_position++];
+  }
+  return true;
+}
+
+bool Decoder::_readData(std::size_t size, std::string_view& data) {
+  if (_payload.size - _position < size) return false;
+  data = std::string_view{reinterpret_cast<const char*>(_payload.data + _position), size};
+  _position += size;
+  return true;
+}
+
+bool Decoder::_nextMessagePack(Item& item) {
+  uint8_t type;
+  if (!_read(type)) return false;
+
+  auto readFloat = [this, &item](int size) {
+    uint64_t bits;
+    if (!_readBigEndian(bits, size)) return false;
+    item.type = Item::Type::Float;
+    if (size == 4) {
+      const uint32_t floatBits = bits;
+      float number;
+      std::memcpy(&number, &floatBits, sizeof(number));
+      item.number = number;
+    } else {
+      std::memcpy(&item.number, &bits, sizeof(item.number));
+    }
+    return true;
+  };
+  auto readSigned = [this, &item](int size) {
+    uint64_t bits;
+    if (!_readBigEndian(bits, size)) return false;
+    // NOTE sign extension of the read value
+    const int shift = 64 - 8 * size;
+    const int64_t value = int64_t(bits << shift) >> shift;
+    if (value >= 0) {
+      item.type = Item::Type::Unsigned;
+      item.unsignedValue = value;
+    } else {
+      item.type = Item::Type::Negative;
+      item.negativeValue = value;
+    }
+    return true;
+  };
+  auto readSized = [this, &item](Item::Type itemType, int size) {
+    item.type = itemType;
+    if (!_readBigEndian(item.unsignedValue, size)) return false;
+    if (itemType == Item::Type::String || itemType == Item::Type::Bytes) {
+      return _readData(item.unsignedValue, item.data);
+    }
+    return true;
+  };
+
+  if (type < 0x80) {
+    item.type = Item::Type::Unsigned;
+    item.unsignedValue = type;
+    return true;
+  }
+  if (type >= 0xe0) {
+    item.type = Item::Type::Negative;
+    item.negativeValue = int8_t(type);
+    return true;
+  }
+  if ((type & 0xf0) == 0x80) {
+    item.type = Item::Type::Map;
+    item.unsignedValue = type & 0x0f;
+    return true;
+  }
+  if ((type & 0xf0) == 0x90) {
+    item.type = Item::Type::Array;
+    item.unsignedValue = type & 0x0f;
+    return true;
+  }
+  if ((type & 0xe0) == 0xa0) {
+    item.type = Item::Type::String;
+    item.unsignedValue = type & 0x1f;
+    return _readData(item.unsignedValue, item.data);
+  }
+
+  switch (type) {
+    case 0xc0: item.type = Item::Type::Nil; return true;
+    case 0xc2: item.type = Item::Type::Bool; return true;
+    case 0xc3:
+      item.type = Item::Type::Bool;
+      item.boolean = true;
+      return true;
+    case 0xc4: return readSized(Item::Type::Bytes, 1);
+    case 0xc5: return readSized(Item::Type::Bytes, 2);
+    case 0xc6: return readSized(Item::Type::Bytes, 4);
+    case 0xca: return readFloat(4);
+    case 0xcb: return readFloat(8);
+    case 0xcc: return readSized(Item::Type::Unsigned, 1);
+    case 0xcd: return readSized(Item::Type::Unsigned, 2);
+    case 0xce: return readSized(Item::Type::Unsigned, 4);
+    case 0xcf: return readSized(Item::Type::Unsigned, 8);
+    case 0xd0: return readSigned(1);
+    case 0xd1: return readSigned(2);
+    case 0xd2: return readSigned(4);
+    case 0xd3: return readSigned(8);
+    case 0xd9: return readSized(Item::Type::String, 1);
+    case 0xda: return readSized(Item::Type::String, 2);
+    case 0xdb: return readSized(Item::Type::String, 4);
+    case 0xdc: return readSized(Item::Type::Array, 2);
+    case 0xdd: return readSized(Item::Type::Array, 4);
+    case 0xde: return readSized(Item::Type::Map, 2);
+    case 0xdf: return readSized(Item::Type::Map, 4);
+    // NOTE extension types aren't supported
+    default: return false;
+  }
+}
+
+bool Decoder::_nextCbor(Item& item) {
+  uint8_t initial;
+  if (!_read(initial)) return false;
+  const uint8_t majorType = initial >> 5;
+  const uint8_t additional = initial & 0x1f;
+
+  uint64_t argument = additional;
+  if (additional >= 24 && additional <= 27) {
+    if (!_readBigEndian(argument, 1 << (additional - 24))) return false;
+  } else if (additional > 27) {
+    // NOTE indefinite lengths aren't supported
+    return false;
+  }
+
+  switch (majorType) {
+    case CBOR_UNSIGNED:
+      item.type = Item::Type::Unsigned;
+      item.unsignedValue = argument;
+      return true;
+    case CBOR_NEGATIVE:
+      if (argument > uint64_t(INT64_MAX)) return false;
+      item.type = Item::Type::Negative;
+      item.negativeValue = -1 - int64_t(argument);
+      return true;
+    case CBOR_BYTES:
+    case CBOR_TEXT:
+      item.type = majorType == CBOR_TEXT ? Item::Type::String : Item::Type::Bytes;
+      item.unsignedValue = argument;
+      return _readData(argument, item.data);
+    case CBOR_ARRAY:
+    case CBOR_MAP:
+      item.type = majorType == CBOR_MAP ? Item::Type::Map : Item::Type::Array;
+      item.unsignedValue = argument;
+      return true;
+    case CBOR_SIMPLE: break;
+    // NOTE tags aren't supported
+    default: return false;
+  }
+
+  switch (additional) {
+    case 20:
+    case 21:
+      item.type = Item::Type::Bool;
+      item.boolean = additional == 21;
+      return true;
+    case 22:
+    case 23: item.type = Item::Type::Nil; return true;
+    case 25: {
+      // NOTE half precision float
+      const int exponent = (argument >> 10) & 0x1f;
+      const double mantissa = argument & 0x3ff;
+      double value = std::ldexp(mantissa + 1024, exponent - 25);
+      if (exponent == 0) {
+        value = std::ldexp(mantissa, -24);
+      } else if (exponent == 31) {
+        value = mantissa == 0 ? INFINITY : NAN;
+      }
+      item.type = Item::Type::Float;
+      item.number = (argument & 0x8000) ? -value : value;
+      return true;
+    }
+    case 26: {
+      const uint32_t bits = argument;
+      float number;
+      std::memcpy(&number, &bits, sizeof(number));
+      item.type = Item::Type::Float;
+      item.number = number;
+      return true;
+    }
+    case 27:
+      item.type = Item::Type::Float;
+      std::memcpy(&item.number, &argument, sizeof(item.number));
+      return true;
+    default: return false;
+  }
+}
+
+}
@@ -0,0 +1,188 @@
+#include "essentials/compressed_storage.hpp"
+#include "essentials/lz.hpp"
+
+#include "esp_timer.h"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+namespace essentials {
+
+struct CompressedStorage::Private {
+  // NOTE blob: [format u8] [raw size u32] [data]
+  enum class Format : uint8_t { Raw = 0, Lz = 1 };
+  static constexpr std::size_t HEADER_SIZE = 5;
+
+  struct Blob {
+    Format format;
+    uint32_t rawSize;
+    Span<uint8_t> data;
+  };
+
+  PersistentStorage& storage;
+  std::size_t minCompressedSize;
+  mutable std::mutex mutex{};
+  mutable std::vector<uint8_t> scratch{};
+  mutable Stats stats{};
+  LzHashTable table{};
+
+  Private(PersistentStorage& storage, std::size_t minCompressedSize) :
+    storage(storage), minCompressedSize(minCompressedSize) {
+  }
+
+  bool load(const StorageKey& key, Blob& blob) const {
+    // NOTE scratch buffer is reused thus only growing blobs cause allocation
+    scratch.resize(std::max(scratch.capacity(), HEADER_SIZE));
+    int size = storage.readInto(key, MutableSpan<uint8_t>{scratch.data(), scratch.size()});
+    if (size > int(scratch.size())) {
+      scratch.resize(size);
+      size = storage.readInto(key, MutableSpan<uint8_t>{scratch.data(), scratch.size()});
+    }
+    if (size < 0) return false;
+    if (size < int(HEADER_SIZE)) {
+      throw std::runtime_error("compressed blob is too small");
+    }
+
+    blob.format = Format(scratch[0]);
+    blob.rawSize = scratch[1] | (scratch[2] << 8) | (scratch[3] << 16) | (uint32_t(scratch[4]) << 24);
+    blob.data = Span<uint8_t>{scratch.data() + HEADER_SIZE, std::size_t(size) - HEADER_SIZE};
+    return true;
+  }
+
+  void decode(const Blob& blob, MutableSpan<uint8_t> buffer) const {
+    if (blob.format == Format::Raw) {
+      if (blob.data.size != blob.rawSize) {
+        throw std::runtime_error("corrupted compressed blob");
+      }
+      std::copy(blob.data.data, blob.data.data + blob.data.size, buffer.data);
+      return;
+    }
+    if (blob.format != Format::Lz) {
+      throw std::runtime_error("unknown compressed blob format");
+    }
+
+    const int64_t start = esp_timer_get_time();
+    const int size = lzDecompress(blob.data, MutableSpan<uint8_t>{buffer.data, blob.rawSize});
+    stats.decodeMicros += esp_timer_get_time() - start;
+    stats.decodes++;
+    if (size != int(blob.rawSize)) {
+      throw std::runtime_error("corrupted compressed blob");
+    }
+  }
+
+  void encode(Span<uint8_t> data, std::vector<uint8_t>& blob) {
+    blob.resize(HEADER_SIZE + data.size);
+    Format format = Format::Raw;
+    std::size_t size = data.size;
+    // NOTE compressed data must be smaller than raw data otherwise data are stored raw, thus data of at most one byte
+    // aren't compressed
+    if (data.size > 1 && data.size >= minCompressedSize) {
+      const std::size_t compressedSize =
+        lzCompress(data, MutableSpan<uint8_t>{blob.data() + HEADER_SIZE, data.size - 1}, table);
+      if (compressedSize > 0) {
+        format = Format::Lz;
+        size = compressedSize;
+      }
+    }
+    if (format == Format::Raw) {
+      std::copy(data.data, data.data + data.size, blob.data() + HEADER_SIZE);
+    }
+
+    blob[0] = uint8_t(format);
+    blob[1] = data.size;
+    blob[2] = data.size >> 8;
+    blob[3] = data.size >> 16;
+    blob[4] = data.size >> 24;
+    blob.resize(HEADER_SIZE + size);
+
+    stats.rawBytes += data.size;
+    stats.storedBytes += blob.size();
+  }
+};
+
+CompressedStorage::CompressedStorage(PersistentStorage& storage, std::size_t minCompressedSize) :
+  p(std::make_unique<Private>(storage, minCompressedSize)) {
+}
+
+CompressedStorage::~CompressedStorage() = default;
+
+int CompressedStorage::size(const StorageKey& key) const {
+  std::lock_guard lock{p->mutex};
+  Private::Blob blob;
+  if (!p->load(key, blob)) return -1;
+  return blob.rawSize;
+}
+
+std::vector<uint8_t> CompressedStorage::read(const StorageKey& key, int size) const {
+  auto buffer = std::vector<uint8_t>{};
+  buffer.resize(size);
+
+  int storedSize = readInto(key, MutableSpan<uint8_t>{buffer.data(), buffer.size()});
+  if (storedSize < 0) {
+    buffer.clear();
+    return buffer;
+  }
+  if (storedSize > size) {
+    throw std::runtime_error("compressed blob is bigger than requested size");
+  }
+
+  return buffer;
+}
+
+int CompressedStorage::readInto(const StorageKey& key, MutableSpan<uint8_t> buffer) const {
+  std::lock_guard lock{p->mutex};
+  Private::Blob blob;
+  if (!p->load(key, blob)) return -1;
+  if (blob.rawSize <= buffer.size) p->decode(blob, buffer);
+  return blob.rawSize;
+}
+
+void CompressedStorage::write(const StorageKey& key, Span<uint8_t> data) {
+  std::lock_guard lock{p->mutex};
+  p->encode(data, p->scratch);
+  p->storage.write(key, Span<uint8_t>{p->scratch.data(), p->scratch.size()});
+}
+
+void CompressedStorage::writeBatch(Span<Entry> entries) {
+  std::lock_guard lock{p->mutex};
+  std::vector<std::vector<uint8_t>> blobs{entries.size};
+  std::vector<Entry> compressedEntries;
+  compressedEntries.reserve(entries.size);
+  for (std::size_t i = 0; i < entries.size; i++) {
+    p->encode(entries.data[i].data, blobs[i]);
+    compressedEntries.push_back(Entry{entries.data[i].key, Span<uint8_t>{blobs[i].data(), blobs[i].size()}});
+  }
+  p->storage.writeBatch(Span<Entry>{compressedEntries.data(), compressedEntries.size()});
+}
+
+void CompressedStorage::clear() {
+  p->storage.clear();
+}
+
+std::vector<StorageKey> CompressedStorage::keys() const {
+  return p->storage.keys();
+}
+
+void CompressedStorage::flush() {
+  p->storage.flush();
+}
+
+void CompressedStorage::begin() {
+  p->storage.begin();
+}
+
+void CompressedStorage::commit() {
+  p->storage.commit();
+}
+
+void CompressedStorage::rollback() {
+  p->storage.rollback();
+}
+
+CompressedStorage::Stats CompressedStorage::stats() const {
+  std::lock_guard lock{p->mutex};
+  return p->stats;
+}
+
+}
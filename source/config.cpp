@@ -2,7 +2,200 @@
 
 namespace essentials {
 
-Config::Config(PersistentStorage& storage) : _storage(storage) {
+Config::Config(PersistentStorage& storage, Mode mode) :
+  _storage(storage),
+  _mode(mode),
+  _shared(_sharedOf(storage)),
+  _state(_shared->state),
+  _writeMutex(_shared->writeMutex) {
+}
+
+Config::CacheStats Config::cacheStats() const {
+  return CacheStats{_cacheHits.load(), _cacheMisses.load()};
+}
+
+PersistentStorage& Config::storage() const {
+  return _storage;
+}
+
+void Config::reload() {
+  _state.modify([](State& state) { state.cache.clear(); });
+}
+
+void Config::flush() {
+  std::lock_guard lock{_writeMutex};
+  _storage.flush();
+}
+
+uint32_t Config::version() const {
+  return _shared->version.load();
+}
+
+uint32_t Config::version(const StorageKey& key) const {
+  return _state.read([&key](const State& state) {
+    auto it = state.keyVersions.find(key);
+    if (it == state.keyVersions.end()) return uint32_t(0);
+    return it->second;
+  });
+}
+
+bool Config::hasChangedSince(uint32_t version) const {
+  return _shared->version.load() != version;
+}
+
+std::unique_ptr<Config::Subscription> Config::subscribe(
+  const StorageKey& key, std::function<void(const StorageKey&)> reaction) {
+  return _subscribe(key, std::move(reaction));
+}
+
+std::unique_ptr<Config::Subscription> Config::subscribe(std::function<void(const StorageKey&)> reaction) {
+  return _subscribe(std::nullopt, std::move(reaction));
+}
+
+void Config::begin() {
+  _writeMutex.lock();
+  if (_shared->isInTransaction) {
+    _writeMutex.unlock();
+    throw std::runtime_error("config transaction is already running");
+  }
+  try {
+    _storage.begin();
+  } catch (...) {
+    _writeMutex.unlock();
+    throw;
+  }
+  _shared->isInTransaction = true;
+}
+
+void Config::commit() {
+  std::lock_guard lock{_writeMutex};
+  if (!_shared->isInTransaction) {
+    throw std::runtime_error("there is no config transaction to commit");
+  }
+
+  try {
+    _storage.commit();
+  } catch (...) {
+    try {
+      rollback();
+    } catch (...) {
+      // NOTE error of commit is more important
+    }
+    throw;
+  }
+
+  _shared->isInTransaction = false;
+  std::vector<StorageKey> changes = std::move(_shared->pendingChanges);
+  _shared->pendingChanges.clear();
+  _writeMutex.unlock();
+  for (const StorageKey& key : changes) {
+    _changed(key);
+  }
+}
+
+void Config::rollback() {
+  std::lock_guard lock{_writeMutex};
+  if (!_shared->isInTransaction) {
+    throw std::runtime_error("there is no config transaction to rollback");
+  }
+
+  _shared->isInTransaction = false;
+  _shared->pendingChanges.clear();
+  // NOTE releases lock taken by begin(), lock_guard above is released on return
+  _writeMutex.unlock();
+  // NOTE cache holds values of the transaction
+  reload();
+  _storage.rollback();
+}
+
+void Config::_storeCached(const StorageKey& key, Span<uint8_t> data) {
+  _state.modify([&key, &data](State& state) { state.cache[key].assign(data.data, data.data + data.size); });
+}
+
+void Config::_saveCached(const StorageKey& key, Span<uint8_t> data) {
+  if (_mode == Mode::Direct) {
+    _dropCached(key);
+  } else {
+    _storeCached(key, data);
+  }
+}
+
+void Config::_dropCached(const StorageKey& key) {
+  _state.modify([&key](State& state) { state.cache.erase(key); });
+}
+
+void Config::_changed(const StorageKey& key) {
+  std::lock_guard lock{_writeMutex};
+  if (_shared->isInTransaction) {
+    std::vector<StorageKey>& pendingChanges = _shared->pendingChanges;
+    if (std::find(pendingChanges.begin(), pendingChanges.end(), key) == pendingChanges.end()) {
+      pendingChanges.push_back(key);
+    }
+    return;
+  }
+
+  const uint32_t version = _shared->version.load() + 1;
+  _state.modify([&key, version](State& state) { state.keyVersions[key] = version; });
+  _shared->version.store(version);
+
+  // NOTE reactions can subscribe and unsubscribe, vector is walked by index and entries deleted meanwhile are only
+  // cleared, they are erased once the outermost notification finishes
+  std::vector<Subscription*>& subscribers = _shared->subscribers;
+  _shared->notifyingDepth++;
+  auto finishNotifying = [&subscribers, this]() {
+    if (--_shared->notifyingDepth > 0) return;
+    subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), nullptr), subscribers.end());
+  };
+  try {
+    for (std::size_t i = 0; i < subscribers.size(); i++) {
+      Subscription* subscriber = subscribers[i];
+      if (!subscriber || (subscriber->key && *subscriber->key != key)) continue;
+
+      std::shared_ptr<const std::function<void(const StorageKey&)>> reaction = subscriber->_reaction;
+      (*reaction)(key);
+    }
+  } catch (...) {
+    finishNotifying();
+    throw;
+  }
+  finishNotifying();
+}
+
+std::shared_ptr<Config::Shared> Config::_sharedOf(PersistentStorage& storage) {
+  static std::mutex mutex{};
+  static std::unordered_map<const PersistentStorage*, std::weak_ptr<Shared>> shares{};
+
+  std::lock_guard lock{mutex};
+  for (auto it = shares.begin(); it != shares.end();) {
+    it = it->second.expired() ? shares.erase(it) : std::next(it);
+  }
+  std::weak_ptr<Shared>& share = shares[&storage];
+  std::shared_ptr<Shared> shared = share.lock();
+  if (!shared) {
+    shared = std::make_shared<Shared>();
+    share = shared;
+  }
+  return shared;
+}
+
+std::unique_ptr<Config::Subscription> Config::_subscribe(
+  std::optional<StorageKey> key, std::function<void(const StorageKey&)> reaction) {
+  std::lock_guard lock{_writeMutex};
+  auto subscription = std::make_unique<Subscription>();
+  subscription->key = key;
+  subscription->_reaction = std::make_shared<const std::function<void(const StorageKey&)>>(std::move(reaction));
+  subscription->_unsubscribe = [shared = _shared, subscriber = subscription.get()]() {
+    std::lock_guard lock{shared->writeMutex};
+    auto it = std::find(shared->subscribers.begin(), shared->subscribers.end(), subscriber);
+    if (shared->notifyingDepth > 0) {
+      *it = nullptr;
+    } else {
+      shared->subscribers.erase(it);
+    }
+  };
+  _shared->subscribers.push_back(subscription.get());
+
+  return subscription;
 }
 
 }
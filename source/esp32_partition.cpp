@@ -0,0 +1,44 @@
+#include "essentials/esp32_partition.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace essentials {
+
+Esp32Partition::Esp32Partition(std::string_view label) :
+  _partition(esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, std::string(label).c_str())) {
+  if (_partition == nullptr) {
+    throw std::runtime_error("couldn't find partition");
+  }
+}
+
+std::size_t Esp32Partition::size() const {
+  return _partition->size;
+}
+
+std::size_t Esp32Partition::sectorSize() const {
+  return SPI_FLASH_SEC_SIZE;
+}
+
+void Esp32Partition::read(std::size_t offset, MutableSpan<uint8_t> buffer) const {
+  esp_err_t error = esp_partition_read(_partition, offset, buffer.data, buffer.size);
+  if (error != ESP_OK) {
+    throw std::runtime_error("error while reading partition");
+  }
+}
+
+void Esp32Partition::write(std::size_t offset, Span<uint8_t> data) {
+  esp_err_t error = esp_partition_write(_partition, offset, data.data, data.size);
+  if (error != ESP_OK) {
+    throw std::runtime_error("error while writing partition");
+  }
+}
+
+void Esp32Partition::erase(std::size_t offset, std::size_t size) {
+  esp_err_t error = esp_partition_erase_range(_partition, offset, size);
+  if (error != ESP_OK) {
+    throw std::runtime_error("error while erasing partition");
+  }
+}
+
+}
@@ -3,6 +3,8 @@
 #include "esp_system.h"
 #include "nvs_flash.h"
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 namespace essentials {
@@ -11,45 +13,212 @@ Esp32Storage::Esp32Storage(std::string_view name) : _name(name) {
   initialize();
 }
 
-int Esp32Storage::size(std::string_view key) const {
+int Esp32Storage::size(const StorageKey& key) const {
+  if (_transaction) {
+    auto it = _transaction->find(key);
+    if (it != _transaction->end()) return it->second.size();
+  }
+
   size_t size = -1;
-  esp_err_t error = nvs_get_blob(_nvsHandle, std::string(key).c_str(), nullptr, &size);
+  esp_err_t error = nvs_get_blob(_nvsHandle, key.c_str(), nullptr, &size);
   if (error != ESP_OK && error != ESP_ERR_NVS_NOT_FOUND) {
     return -1;
   }
   return size;
 }
 
-std::vector<uint8_t> Esp32Storage::read(std::string_view key, int size) const {
+std::vector<uint8_t> Esp32Storage::read(const StorageKey& key, int size) const {
   auto buffer = std::vector<uint8_t>{};
   buffer.resize(size);
 
-  size_t blobSize = size;
-  esp_err_t error = nvs_get_blob(_nvsHandle, std::string(key).c_str(), buffer.data(), &blobSize);
-  if (error == ESP_ERR_NVS_NOT_FOUND) {
+  int storedSize = readInto(key, MutableSpan<uint8_t>{buffer.data(), buffer.size()});
+  if (storedSize < 0) {
     buffer.clear();
     return buffer;
   }
-  if (error != ESP_OK) {
+  if (storedSize > size) {
     throw std::runtime_error("error while getting NVS blob");
   }
 
   return buffer;
 }
 
-void Esp32Storage::write(std::string_view key, Span<uint8_t> data) {
-  esp_err_t error = nvs_set_blob(_nvsHandle, std::string(key).c_str(), data.data, data.size);
+int Esp32Storage::readInto(const StorageKey& key, MutableSpan<uint8_t> buffer) const {
+  if (_transaction) {
+    auto it = _transaction->find(key);
+    if (it != _transaction->end()) {
+      if (it->second.size() <= buffer.size) {
+        std::copy(it->second.begin(), it->second.end(), buffer.data);
+      }
+      return it->second.size();
+    }
+  }
+
+  size_t blobSize = buffer.size;
+  esp_err_t error = nvs_get_blob(_nvsHandle, key.c_str(), buffer.data, &blobSize);
+  if (error == ESP_ERR_NVS_NOT_FOUND) {
+    return -1;
+  }
+  if (error != ESP_OK && error != ESP_ERR_NVS_INVALID_LENGTH) {
+    throw std::runtime_error("error while getting NVS blob");
+  }
+
+  return blobSize;
+}
+
+void Esp32Storage::write(const StorageKey& key, Span<uint8_t> data) {
+  if (_transaction) {
+    (*_transaction)[key].assign(data.data, data.data + data.size);
+    return;
+  }
+
+  set(key, data);
+  commitNvs();
+}
+
+void Esp32Storage::writeBatch(Span<Entry> entries) {
+  if (entries.size == 0) return;
+
+  if (_transaction) {
+    for (std::size_t i = 0; i < entries.size; i++) {
+      write(entries.data[i].key, entries.data[i].data);
+    }
+    return;
+  }
+
+  for (std::size_t i = 0; i < entries.size; i++) {
+    set(entries.data[i].key, entries.data[i].data);
+  }
+  commitNvs();
+}
+
+std::vector<StorageKey> Esp32Storage::keys() const {
+  std::vector<StorageKey> keys;
+  nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, _name.c_str(), NVS_TYPE_BLOB);
+  while (it != nullptr) {
+    nvs_entry_info_t info;
+    nvs_entry_info(it, &info);
+    StorageKey key{std::string_view{info.key}};
+    if (key != JOURNAL_KEY && (!_transaction || _transaction->count(key) == 0)) keys.push_back(key);
+    it = nvs_entry_next(it);
+  }
+
+  if (_transaction) {
+    for (const auto& [key, data] : *_transaction) {
+      keys.push_back(key);
+    }
+  }
+  return keys;
+}
+
+void Esp32Storage::begin() {
+  if (_transaction) {
+    throw std::runtime_error("transaction is already running");
+  }
+  _transaction.emplace();
+}
+
+void Esp32Storage::commit() {
+  if (!_transaction) {
+    throw std::runtime_error("there is no transaction to commit");
+  }
+  auto transaction = std::move(*_transaction);
+  _transaction.reset();
+  if (transaction.empty()) return;
+
+  // journal: [entry count u16] ([key size u8] [key] [data size u32] [data])... [crc32 u32]
+  std::vector<uint8_t> journal;
+  auto append = [&journal](const void* data, std::size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    journal.insert(journal.end(), bytes, bytes + size);
+  };
+  const uint16_t count = transaction.size();
+  append(&count, sizeof(count));
+  for (const auto& [key, data] : transaction) {
+    const uint8_t keySize = key.view().size();
+    const uint32_t dataSize = data.size();
+    append(&keySize, sizeof(keySize));
+    append(key.c_str(), keySize);
+    append(&dataSize, sizeof(dataSize));
+    append(data.data(), data.size());
+  }
+  const uint32_t crc = crc32(Span<uint8_t>{journal.data(), journal.size()});
+  append(&crc, sizeof(crc));
+
+  // NOTE previous values undo partially written transaction when a write fails
+  std::vector<std::pair<StorageKey, std::vector<uint8_t>>> previousValues;
+  previousValues.reserve(transaction.size());
+  for (const auto& [key, data] : transaction) {
+    const int previousSize = size(key);
+    if (previousSize >= 0) previousValues.emplace_back(key, read(key, previousSize));
+  }
+
+  // NOTE NVS writes each blob atomically, if power is lost after journal is written it is replayed on next start
+  set(JOURNAL_KEY, Span<uint8_t>{journal.data(), journal.size()});
+  try {
+    for (const auto& [key, data] : transaction) {
+      set(key, Span<uint8_t>{data.data(), data.size()});
+    }
+    erase(JOURNAL_KEY);
+    commitNvs();
+  } catch (...) {
+    // NOTE failed transaction mustn't be replayed by journal recovery, values are restored as far as possible
+    try {
+      for (const auto& [key, data] : transaction) {
+        auto previous = std::find_if(previousValues.begin(), previousValues.end(), [&key = key](const auto& value) {
+          return value.first == key;
+        });
+        if (previous == previousValues.end()) {
+          erase(key);
+        } else {
+          set(key, Span<uint8_t>{previous->second.data(), previous->second.size()});
+        }
+      }
+    } catch (...) {
+      // NOTE error of commit is more important
+    }
+    try {
+      erase(JOURNAL_KEY);
+      commitNvs();
+    } catch (...) {
+      // NOTE error of commit is more important
+    }
+    throw;
+  }
+}
+
+void Esp32Storage::rollback() {
+  _transaction.reset();
+}
+
+uint32_t Esp32Storage::commitCount() const {
+  return _commitCount;
+}
+
+void Esp32Storage::set(const StorageKey& key, Span<uint8_t> data) {
+  esp_err_t error = nvs_set_blob(_nvsHandle, key.c_str(), data.data, data.size);
   if (error != ESP_OK) {
     throw std::runtime_error("error while writing to NVS");
   }
+}
 
-  error = nvs_commit(_nvsHandle);
+void Esp32Storage::erase(const StorageKey& key) {
+  esp_err_t error = nvs_erase_key(_nvsHandle, key.c_str());
+  if (error != ESP_OK && error != ESP_ERR_NVS_NOT_FOUND) {
+    throw std::runtime_error("error while erasing NVS key");
+  }
+}
+
+void Esp32Storage::commitNvs() {
+  esp_err_t error = nvs_commit(_nvsHandle);
   if (error != ESP_OK) {
     throw std::runtime_error("error while committing NVS");
   }
+  _commitCount++;
 }
 
 void Esp32Storage::clear() {
+  _transaction.reset();
   esp_err_t error = nvs_erase_all(_nvsHandle);
   if (error != ESP_OK) {
     throw std::runtime_error("couldn't erase flash");
@@ -74,6 +243,38 @@ void Esp32Storage::initialize() {
   if (error != ESP_OK) {
     throw std::runtime_error("error while opening NVS");
   }
+
+  recoverJournal();
+}
+
+void Esp32Storage::recoverJournal() {
+  std::vector<uint8_t> journal = read(JOURNAL_KEY, std::max(size(JOURNAL_KEY), 0));
+  if (journal.empty()) return;
+
+  const std::size_t crcOffset = journal.size() - std::min(journal.size(), sizeof(uint32_t));
+  uint32_t crc = 0;
+  std::memcpy(&crc, journal.data() + crcOffset, journal.size() - crcOffset);
+  if (crc == crc32(Span<uint8_t>{journal.data(), crcOffset}) && crcOffset >= sizeof(uint16_t)) {
+    std::size_t offset = 0;
+    auto take = [&journal, &offset](void* data, std::size_t size) {
+      std::memcpy(data, journal.data() + offset, size);
+      offset += size;
+    };
+    uint16_t count = 0;
+    take(&count, sizeof(count));
+    for (uint16_t i = 0; i < count; i++) {
+      uint8_t keySize = 0;
+      uint32_t dataSize = 0;
+      take(&keySize, sizeof(keySize));
+      std::string_view key{reinterpret_cast<const char*>(journal.data() + offset), keySize};
+      offset += keySize;
+      take(&dataSize, sizeof(dataSize));
+      set(StorageKey{key}, Span<uint8_t>{journal.data() + offset, dataSize});
+      offset += dataSize;
+    }
+  }
+  erase(JOURNAL_KEY);
+  commitNvs();
 }
 
 Esp32Storage::~Esp32Storage() {
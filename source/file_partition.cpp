@@ -0,0 +1,102 @@
+#include "essentials/file_partition.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+
+namespace essentials {
+
+FilePartition::FilePartition(std::string_view path, std::size_t size, std::size_t sectorSize) :
+  _size(size), _sectorSize(sectorSize) {
+  if (sectorSize == 0 || size % sectorSize != 0) {
+    throw std::runtime_error("partition size must be multiple of sector size");
+  }
+
+  std::string filePath{path};
+  _file = std::fopen(filePath.c_str(), "r+b");
+  if (_file == nullptr) {
+    _file = std::fopen(filePath.c_str(), "w+b");
+  }
+  if (_file == nullptr) {
+    throw std::runtime_error("couldn't open partition file");
+  }
+
+  std::fseek(_file, 0, SEEK_END);
+  const long fileSize = std::ftell(_file);
+  if (fileSize < long(size)) {
+    // NOTE missing part of partition is erased flash
+    std::array<uint8_t, 64> erased;
+    erased.fill(0xff);
+    for (std::size_t offset = std::max(fileSize, 0L); offset < size; offset += erased.size()) {
+      std::fwrite(erased.data(), 1, std::min(erased.size(), size - offset), _file);
+    }
+    std::fflush(_file);
+  }
+}
+
+FilePartition::~FilePartition() {
+  std::fclose(_file);
+}
+
+std::size_t FilePartition::size() const {
+  return _size;
+}
+
+std::size_t FilePartition::sectorSize() const {
+  return _sectorSize;
+}
+
+void FilePartition::read(std::size_t offset, MutableSpan<uint8_t> buffer) const {
+  checkRange(offset, buffer.size);
+  seek(offset);
+  if (std::fread(buffer.data, 1, buffer.size, _file) != buffer.size) {
+    throw std::runtime_error("error while reading partition file");
+  }
+}
+
+void FilePartition::write(std::size_t offset, Span<uint8_t> data) {
+  checkRange(offset, data.size);
+  std::array<uint8_t, 64> chunk;
+  for (std::size_t done = 0; done < data.size; done += chunk.size()) {
+    const std::size_t chunkSize = std::min(chunk.size(), data.size - done);
+    read(offset + done, MutableSpan<uint8_t>{chunk.data(), chunkSize});
+    for (std::size_t i = 0; i < chunkSize; i++) {
+      chunk[i] &= data.data[done + i];
+    }
+    seek(offset + done);
+    if (std::fwrite(chunk.data(), 1, chunkSize, _file) != chunkSize) {
+      throw std::runtime_error("error while writing partition file");
+    }
+  }
+  std::fflush(_file);
+}
+
+void FilePartition::erase(std::size_t offset, std::size_t size) {
+  checkRange(offset, size);
+  if (offset % _sectorSize != 0 || size % _sectorSize != 0) {
+    throw std::runtime_error("erase range must be aligned to sectors");
+  }
+
+  std::array<uint8_t, 64> erased;
+  erased.fill(0xff);
+  seek(offset);
+  for (std::size_t done = 0; done < size; done += erased.size()) {
+    std::fwrite(erased.data(), 1, std::min(erased.size(), size - done), _file);
+  }
+  std::fflush(_file);
+}
+
+void FilePartition::seek(std::size_t offset) const {
+  if (std::fseek(_file, long(offset), SEEK_SET) != 0) {
+    throw std::runtime_error("error while seeking in partition file");
+  }
+}
+
+void FilePartition::checkRange(std::size_t offset, std::size_t size) const {
+  if (offset > _size || size > _size - offset) {
+    throw std::runtime_error("partition access out of range");
+  }
+}
+
+}
@@ -0,0 +1,637 @@
+#include "essentials/float_conversion.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace essentials {
+
+// NOTE shortest round-trip formatting is Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+// Accurately with Integers"), numbers are represented as 64-bit significand f and binary exponent e (f * 2^e)
+struct DiyFp {
+  uint64_t f;
+  int e;
+};
+
+static DiyFp diyFpMultiply(DiyFp x, DiyFp y) {
+  const uint64_t xLow = x.f & 0xffffffff;
+  const uint64_t xHigh = x.f >> 32;
+  const uint64_t yLow = y.f & 0xffffffff;
+  const uint64_t yHigh = y.f >> 32;
+
+  const uint64_t lowLow = xLow * yLow;
+  const uint64_t lowHigh = xLow * yHigh;
+  const uint64_t highLow = xHigh * yLow;
+  const uint64_t highHigh = xHigh * yHigh;
+
+  // NOTE upper 64 bits of 128-bit product rounded to nearest
+  uint64_t middle = (lowLow >> 32) + (lowHigh & 0xffffffff) + (highLow & 0xffffffff);
+  middle += uint64_t{1} << 31;
+  return DiyFp{highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32), x.e + y.e + 64};
+}
+
+static DiyFp diyFpNormalize(DiyFp x) {
+  while ((x.f >> 63) == 0) {
+    x.f <<= 1;
+    x.e--;
+  }
+  return x;
+}
+
+/**
+ * @brief Value and its rounding boundaries, every number in (minus, plus) is parsed back to the value
+ */
+struct FloatBoundaries {
+  DiyFp value;
+  DiyFp minus;
+  DiyFp plus;
+};
+
+template<typename T, typename Bits>
+static FloatBoundaries floatBoundaries(T number) {
+  constexpr int precision = std::numeric_limits<T>::digits;
+  constexpr int bias = std::numeric_limits<T>::max_exponent - 1 + (precision - 1);
+  constexpr int minExponent = 1 - bias;
+  constexpr uint64_t hiddenBit = uint64_t{1} << (precision - 1);
+
+  Bits bits;
+  std::memcpy(&bits, &number, sizeof(bits));
+  const uint64_t exponent = bits >> (precision - 1);
+  const uint64_t fraction = bits & (hiddenBit - 1);
+
+  const DiyFp value =
+    exponent == 0 ? DiyFp{fraction, minExponent} : DiyFp{fraction + hiddenBit, int(exponent) - bias};
+  // NOTE lower boundary is closer at powers of two because exponent of the lower neighbour is smaller
+  const bool isLowerBoundaryCloser = fraction == 0 && exponent > 1;
+  const DiyFp plus = diyFpNormalize(DiyFp{2 * value.f + 1, value.e - 1});
+  DiyFp minus = isLowerBoundaryCloser ? DiyFp{4 * value.f - 1, value.e - 2} : DiyFp{2 * value.f - 1, value.e - 1};
+  minus.f <<= minus.e - plus.e;
+  minus.e = plus.e;
+  return FloatBoundaries{diyFpNormalize(value), minus, plus};
+}
+
+struct CachedPower {
+  uint64_t f;
+  int e;
+  int k;
+};
+
+// NOTE normalized 10^k for k = -300, -292, ..., 324
+static constexpr CachedPower CACHED_POWERS[] = {
+  {0xab70fe17c79ac6ca, -1060, -300},
+  {0xff77b1fcbebcdc4f, -1034, -292},
+  {0xbe5691ef416bd60c, -1007, -284},
+  {0x8dd01fad907ffc3c, -980, -276},
+  {0xd3515c2831559a83, -954, -268},
+  {0x9d71ac8fada6c9b5, -927, -260},
+  {0xea9c227723ee8bcb, -901, -252},
+  {0xaecc49914078536d, -874, -244},
+  {0x823c12795db6ce57, -847, -236},
+  {0xc21094364dfb5637, -821, -228},
+  {0x9096ea6f3848984f, -794, -220},
+  {0xd77485cb25823ac7, -768, -212},
+  {0xa086cfcd97bf97f4, -741, -204},
+  {0xef340a98172aace5, -715, -196},
+  {0xb23867fb2a35b28e, -688, -188},
+  {0x84c8d4dfd2c63f3b, -661, -180},
+  {0xc5dd44271ad3cdba, -635, -172},
+  {0x936b9fcebb25c996, -608, -164},
+  {0xdbac6c247d62a584, -582, -156},
+  {0xa3ab66580d5fdaf6, -555, -148},
+  {0xf3e2f893dec3f126, -529, -140},
+  {0xb5b5ada8aaff80b8, -502, -132},
+  {0x87625f056c7c4a8b, -475, -124},
+  {0xc9bcff6034c13053, -449, -116},
+  {0x964e858c91ba2655, -422, -108},
+  {0xdff9772470297ebd, -396, -100},
+  {0xa6dfbd9fb8e5b88f, -369, -92},
+  {0xf8a95fcf88747d94, -343, -84},
+  {0xb94470938fa89bcf, -316, -76},
+  {0x8a08f0f8bf0f156b, -289, -68},
+  {0xcdb02555653131b6, -263, -60},
+  {0x993fe2c6d07b7fac, -236, -52},
+  {0xe45c10c42a2b3b06, -210, -44},
+  {0xaa242499697392d3, -183, -36},
+  {0xfd87b5f28300ca0e, -157, -28},
+  {0xbce5086492111aeb, -130, -20},
+  {0x8cbccc096f5088cc, -103, -12},
+  {0xd1b71758e219652c, -77, -4},
+  {0x9c40000000000000, -50, 4},
+  {0xe8d4a51000000000, -24, 12},
+  {0xad78ebc5ac620000, 3, 20},
+  {0x813f3978f8940984, 30, 28},
+  {0xc097ce7bc90715b3, 56, 36},
+  {0x8f7e32ce7bea5c70, 83, 44},
+  {0xd5d238a4abe98068, 109, 52},
+  {0x9f4f2726179a2245, 136, 60},
+  {0xed63a231d4c4fb27, 162, 68},
+  {0xb0de65388cc8ada8, 189, 76},
+  {0x83c7088e1aab65db, 216, 84},
+  {0xc45d1df942711d9a, 242, 92},
+  {0x924d692ca61be758, 269, 100},
+  {0xda01ee641a708dea, 295, 108},
+  {0xa26da3999aef774a, 322, 116},
+  {0xf209787bb47d6b85, 348, 124},
+  {0xb454e4a179dd1877, 375, 132},
+  {0x865b86925b9bc5c2, 402, 140},
+  {0xc83553c5c8965d3d, 428, 148},
+  {0x952ab45cfa97a0b3, 455, 156},
+  {0xde469fbd99a05fe3, 481, 164},
+  {0xa59bc234db398c25, 508, 172},
+  {0xf6c69a72a3989f5c, 534, 180},
+  {0xb7dcbf5354e9bece, 561, 188},
+  {0x88fcf317f22241e2, 588, 196},
+  {0xcc20ce9bd35c78a5, 614, 204},
+  {0x98165af37b2153df, 641, 212},
+  {0xe2a0b5dc971f303a, 667, 220},
+  {0xa8d9d1535ce3b396, 694, 228},
+  {0xfb9b7cd9a4a7443c, 720, 236},
+  {0xbb764c4ca7a44410, 747, 244},
+  {0x8bab8eefb6409c1a, 774, 252},
+  {0xd01fef10a657842c, 800, 260},
+  {0x9b10a4e5e9913129, 827, 268},
+  {0xe7109bfba19c0c9d, 853, 276},
+  {0xac2820d9623bf429, 880, 284},
+  {0x80444b5e7aa7cf85, 907, 292},
+  {0xbf21e44003acdd2d, 933, 300},
+  {0x8e679c2f5e44ff8f, 960, 308},
+  {0xd433179d9c8cb841, 986, 316},
+  {0x9e19db92b4e31ba9, 1013, 324}
+};
+static constexpr int MIN_CACHED_DECIMAL_EXPONENT = -300;
+static constexpr int MAX_CACHED_DECIMAL_EXPONENT = 324;
+static constexpr int CACHED_DECIMAL_EXPONENT_STEP = 8;
+
+/**
+ * @brief Cached power of ten c = 10^-k such that binary exponent of product with c is in [-60, -32]
+ */
+static CachedPower cachedPower(int e) {
+  constexpr int alpha = -60;
+
+  // NOTE k = ceil((alpha - e - 1) * log10(2)), 78913 / 2^18 approximates log10(2)
+  const int f = alpha - e - 1;
+  const int k = (f * 78913) / (1 << 18) + (f > 0);
+  const int index =
+    (-MIN_CACHED_DECIMAL_EXPONENT + k + (CACHED_DECIMAL_EXPONENT_STEP - 1)) / CACHED_DECIMAL_EXPONENT_STEP;
+  return CACHED_POWERS[index];
+}
+
+static int largestPow10(uint32_t number, uint32_t& pow10) {
+  pow10 = 1000000000;
+  int digits = 10;
+  while (digits > 1 && number < pow10) {
+    pow10 /= 10;
+    digits--;
+  }
+  return digits;
+}
+
+static void grisuRound(char* digits, int length, uint64_t distance, uint64_t delta, uint64_t rest, uint64_t tenK) {
+  // NOTE moves last digit closer to the exact value while it stays in the rounding interval
+  while (rest < distance && delta - rest >= tenK &&
+    (rest + tenK < distance || distance - rest > rest + tenK - distance)) {
+    digits[length - 1]--;
+    rest += tenK;
+  }
+}
+
+/**
+ * @brief Generate shortest digits of a number in (minus, plus) closest to value
+ */
+static int grisuDigits(char* digits, int& decimalExponent, DiyFp minus, DiyFp value, DiyFp plus) {
+  uint64_t delta = plus.f - minus.f;
+  uint64_t distance = plus.f - value.f;
+  const int shift = -plus.e;
+  const uint64_t one = uint64_t{1} << shift;
+
+  uint32_t integral = plus.f >> shift;
+  uint64_t fractional = plus.f & (one - 1);
+  int length = 0;
+
+  uint32_t pow10;
+  int remainingDigits = largestPow10(integral, pow10);
+  while (remainingDigits > 0) {
+    digits[length++] = char('0' + integral / pow10);
+    integral %= pow10;
+    remainingDigits--;
+
+    const uint64_t rest = (uint64_t{integral} << shift) + fractional;
+    if (rest <= delta) {
+      decimalExponent += remainingDigits;
+      grisuRound(digits, length, distance, delta, rest, uint64_t{pow10} << shift);
+      return length;
+    }
+    pow10 /= 10;
+  }
+
+  int fractionalDigits = 0;
+  while (true) {
+    fractional *= 10;
+    digits[length++] = char('0' + (fractional >> shift));
+    fractional &= one - 1;
+    fractionalDigits++;
+    delta *= 10;
+    distance *= 10;
+    if (fractional <= delta) break;
+  }
+  decimalExponent -= fractionalDigits;
+  grisuRound(digits, length, distance, delta, fractional, one);
+  return length;
+}
+
+/**
+ * @brief Place decimal point into digits d1...dk of number 0.d1...dk * 10^n
+ */
+static std::size_t formatDigits(char* text, int length, int n) {
+  constexpr int maxFixedExponent = 15;
+  constexpr int minFixedExponent = -4;
+
+  if (length <= n && n <= maxFixedExponent) {
+    // NOTE digits000.0
+    std::fill(text + length, text + n, '0');
+    text[n] = '.';
+    text[n + 1] = '0';
+    return n + 2;
+  }
+  if (0 < n && n <= maxFixedExponent) {
+    // NOTE dig.its
+    std::memmove(text + n + 1, text + n, length - n);
+    text[n] = '.';
+    return length + 1;
+  }
+  if (minFixedExponent < n && n <= 0) {
+    // NOTE 0.000digits
+    std::memmove(text + 2 - n, text, length);
+    text[0] = '0';
+    text[1] = '.';
+    std::fill(text + 2, text + 2 - n, '0');
+    return 2 - n + length;
+  }
+
+  // NOTE d.igitse+XX
+  std::size_t size = 1;
+  if (length > 1) {
+    std::memmove(text + 2, text + 1, length - 1);
+    text[1] = '.';
+    size = length + 1;
+  }
+  int exponent = n - 1;
+  text[size++] = 'e';
+  text[size++] = exponent < 0 ? '-' : '+';
+  exponent = exponent < 0 ? -exponent : exponent;
+  if (exponent >= 100) text[size++] = char('0' + exponent / 100);
+  text[size++] = char('0' + exponent / 10 % 10);
+  text[size++] = char('0' + exponent % 10);
+  return size;
+}
+
+template<typename T, typename Bits>
+static std::size_t formatFloatImpl(T number, MutableSpan<char> output) {
+  if (!std::isfinite(number)) return 0;
+
+  std::array<char, MAX_FLOAT_CHARS> text;
+  std::size_t size = 0;
+  if (std::signbit(number)) {
+    text[size++] = '-';
+    number = -number;
+  }
+
+  if (number == 0) {
+    text[size++] = '0';
+    text[size++] = '.';
+    text[size++] = '0';
+  } else {
+    const FloatBoundaries boundaries = floatBoundaries<T, Bits>(number);
+    const CachedPower power = cachedPower(boundaries.plus.e);
+    const DiyFp cached{power.f, power.e};
+    const DiyFp value = diyFpMultiply(boundaries.value, cached);
+    DiyFp minus = diyFpMultiply(boundaries.minus, cached);
+    DiyFp plus = diyFpMultiply(boundaries.plus, cached);
+    // NOTE boundaries are narrowed by one unit because products are inexact
+    minus.f++;
+    plus.f--;
+
+    int decimalExponent = -power.k;
+    const int length = grisuDigits(text.data() + size, decimalExponent, minus, value, plus);
+    size += formatDigits(text.data() + size, length, length + decimalExponent);
+  }
+
+  if (size > output.size) return 0;
+  std::copy(text.data(), text.data() + size, output.data);
+  return size;
+}
+
+std::size_t formatFloat(double number, MutableSpan<char> output) {
+  return formatFloatImpl<double, uint64_t>(number, output);
+}
+
+std::size_t formatFloat(float number, MutableSpan<char> output) {
+  return formatFloatImpl<float, uint32_t>(number, output);
+}
+
+// NOTE parsing takes Clinger's fast path when significand and power of ten are exact in the type, otherwise
+// significand is multiplied by cached power of ten with tracked error (as DiyFpStrtod of double-conversion), strto*
+// is called only when the error doesn't decide rounding or exponent is beyond the cached powers
+static constexpr int MAX_SIGNIFICAND_DIGITS = 19;
+static constexpr int MAX_FALLBACK_DIGITS = 40;
+static constexpr int MAX_EXPONENT_DIGITS_VALUE = 100000;
+
+static constexpr double EXACT_POWERS_OF_TEN[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// NOTE normalized 10^1, ..., 10^7 which are between cached powers
+static constexpr DiyFp ADJUSTMENT_POWERS[] = {
+  {0xa000000000000000, -60},
+  {0xc800000000000000, -57},
+  {0xfa00000000000000, -54},
+  {0x9c40000000000000, -50},
+  {0xc350000000000000, -47},
+  {0xf424000000000000, -44},
+  {0x9896800000000000, -40}
+};
+
+/**
+ * @brief Decimal number text [+-]digits[.digits][(e|E)[+-]digits] split into its parts
+ */
+struct DecimalText {
+  bool isNegative;
+  std::string_view mantissa;
+  int exponent;
+};
+
+static bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+/**
+ * @brief Scan decimal number at the beginning of text
+ *
+ * @return false if text doesn't start with a decimal number
+ */
+static bool scanDecimal(std::string_view text, DecimalText& decimal) {
+  std::size_t position = 0;
+  decimal.isNegative = false;
+  if (position < text.size() && (text[position] == '-' || text[position] == '+')) {
+    decimal.isNegative = text[position] == '-';
+    position++;
+  }
+
+  // NOTE hexadecimal numbers are left to strto*
+  const std::size_t mantissaBegin = position;
+  if (text.substr(position, 2) == "0x" || text.substr(position, 2) == "0X") return false;
+  bool hasDigits = false;
+  bool hasPoint = false;
+  for (; position < text.size(); position++) {
+    if (text[position] == '.' && !hasPoint) {
+      hasPoint = true;
+    } else if (isDigit(text[position])) {
+      hasDigits = true;
+    } else {
+      break;
+    }
+  }
+  if (!hasDigits) return false;
+  decimal.mantissa = text.substr(mantissaBegin, position - mantissaBegin);
+
+  decimal.exponent = 0;
+  if (position < text.size() && (text[position] == 'e' || text[position] == 'E')) {
+    position++;
+    const bool isExponentNegative = position < text.size() && text[position] == '-';
+    if (position < text.size() && (text[position] == '-' || text[position] == '+')) position++;
+    // NOTE exponent is clamped, numbers so far out of range are zero or infinity anyway
+    for (; position < text.size() && isDigit(text[position]); position++) {
+      if (decimal.exponent < MAX_EXPONENT_DIGITS_VALUE) decimal.exponent = decimal.exponent * 10 + (text[position] - '0');
+    }
+    if (isExponentNegative) decimal.exponent = -decimal.exponent;
+  }
+  return true;
+}
+
+/**
+ * @brief Significant digits of mantissa, number is digits * 10^exponent
+ */
+struct Significand {
+  int digitCount;
+  int exponent;
+  // NOTE some dropped digits are nonzero, the first dropped digit is 5 or more
+  bool isTruncated;
+  bool isRoundedUp;
+};
+
+/**
+ * @brief Pass at most maxDigits significant digits of mantissa to consume
+ */
+template<typename Consume>
+static Significand readSignificand(std::string_view mantissa, int maxDigits, Consume consume) {
+  Significand significand{0, 0, false, false};
+  bool isFraction = false;
+  bool hasDropped = false;
+  for (const char c : mantissa) {
+    if (c == '.') {
+      isFraction = true;
+    } else if (significand.digitCount == 0 && c == '0') {
+      if (isFraction) significand.exponent--;
+    } else if (significand.digitCount < maxDigits) {
+      consume(c);
+      significand.digitCount++;
+      if (isFraction) significand.exponent--;
+    } else {
+      if (!hasDropped) significand.isRoundedUp = c >= '5';
+      hasDropped = true;
+      significand.isTruncated |= c != '0';
+      if (!isFraction) significand.exponent++;
+    }
+  }
+  return significand;
+}
+
+template<typename T, typename Bits>
+static T diyFpToFloat(DiyFp number) {
+  constexpr int precision = std::numeric_limits<T>::digits;
+  constexpr int bias = std::numeric_limits<T>::max_exponent - 1 + (precision - 1);
+  constexpr int minExponent = 1 - bias;
+  constexpr int maxExponent = 2 * std::numeric_limits<T>::max_exponent - 1 - bias;
+  constexpr uint64_t hiddenBit = uint64_t{1} << (precision - 1);
+
+  while (number.f >= 2 * hiddenBit) {
+    number.f >>= 1;
+    number.e++;
+  }
+  if (number.e >= maxExponent) return std::numeric_limits<T>::infinity();
+  if (number.e < minExponent) return 0;
+  while (number.e > minExponent && (number.f & hiddenBit) == 0) {
+    number.f <<= 1;
+    number.e--;
+  }
+
+  const uint64_t exponent = number.e == minExponent && (number.f & hiddenBit) == 0 ? 0 : number.e + bias;
+  const Bits bits = Bits((number.f & (hiddenBit - 1)) | (exponent << (precision - 1)));
+  T result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+/**
+ * @brief Convert significand * 10^exponent to the closest number
+ *
+ * @return false if the closest number can't be decided without exact arithmetic
+ */
+template<typename T, typename Bits>
+static bool decimalToFloat(uint64_t significand, int digitCount, int exponent, bool isTruncated, T& number) {
+  constexpr int precision = std::numeric_limits<T>::digits;
+  constexpr int maxExactExponent = precision > 24 ? 22 : 10;
+
+  if (significand == 0) {
+    number = 0;
+    return true;
+  }
+  if (!isTruncated && significand <= (uint64_t{1} << precision) && -maxExactExponent <= exponent &&
+    exponent <= maxExactExponent) {
+    const T power = T(EXACT_POWERS_OF_TEN[exponent < 0 ? -exponent : exponent]);
+    number = exponent < 0 ? T(significand) / power : T(significand) * power;
+    return true;
+  }
+  if (exponent + digitCount > std::numeric_limits<T>::max_exponent10 + 1) {
+    number = std::numeric_limits<T>::infinity();
+    return true;
+  }
+  if (exponent < MIN_CACHED_DECIMAL_EXPONENT ||
+    exponent >= MAX_CACHED_DECIMAL_EXPONENT + CACHED_DECIMAL_EXPONENT_STEP) {
+    return false;
+  }
+
+  // NOTE error is in 1/8 of unit in the last place of the 64-bit significand
+  constexpr int denominatorLog = 3;
+  constexpr uint64_t denominator = uint64_t{1} << denominatorLog;
+  DiyFp value = diyFpNormalize(DiyFp{significand, 0});
+  uint64_t error = isTruncated ? (denominator / 2) << -value.e : 0;
+
+  const CachedPower& power =
+    CACHED_POWERS[(exponent - MIN_CACHED_DECIMAL_EXPONENT) / CACHED_DECIMAL_EXPONENT_STEP];
+  const int adjustment = exponent - power.k;
+  if (adjustment > 0) {
+    value = diyFpMultiply(value, ADJUSTMENT_POWERS[adjustment - 1]);
+    // NOTE product is exact while it fits into 64 bits
+    if (MAX_SIGNIFICAND_DIGITS - digitCount < adjustment) error += denominator / 2;
+  }
+  value = diyFpMultiply(value, DiyFp{power.f, power.e});
+  // NOTE cached power and product are rounded to half a unit
+  error += denominator / 2 + (error == 0 ? 0 : 1) + denominator / 2;
+  const int shift = value.e;
+  value = diyFpNormalize(value);
+  error <<= shift - value.e;
+
+  // NOTE subnormal numbers have fewer significant bits
+  constexpr int bias = std::numeric_limits<T>::max_exponent - 1 + (precision - 1);
+  constexpr int minExponent = 1 - bias;
+  const int magnitude = 64 + value.e;
+  int droppedBits = 64 - precision;
+  if (magnitude <= minExponent) {
+    droppedBits = 64;
+  } else if (magnitude < minExponent + precision) {
+    droppedBits = 64 - (magnitude - minExponent);
+  }
+  if (droppedBits + denominatorLog >= 64) {
+    const int droppedShift = droppedBits + denominatorLog - 64 + 1;
+    value.f >>= droppedShift;
+    value.e += droppedShift;
+    error = (error >> droppedShift) + 1 + denominator;
+    droppedBits -= droppedShift;
+  }
+
+  const uint64_t dropped = (value.f & ((uint64_t{1} << droppedBits) - 1)) * denominator;
+  const uint64_t halfWay = (uint64_t{1} << (droppedBits - 1)) * denominator;
+  if (halfWay - error < dropped && dropped < halfWay + error) return false;
+
+  DiyFp rounded{value.f >> droppedBits, value.e + droppedBits};
+  if (dropped >= halfWay + error) rounded.f++;
+  number = diyFpToFloat<T, Bits>(rounded);
+  return true;
+}
+
+template<typename T, typename Parser>
+static bool parseWithFallback(const char* text, T& number, Parser parser) {
+  char* end = nullptr;
+  errno = 0;
+  const T parsed = parser(text, &end);
+  if (end == text) return false;
+  // NOTE underflow into subnormal numbers is accepted so they round-trip
+  if (errno == ERANGE && std::isinf(parsed)) return false;
+
+  number = parsed;
+  return true;
+}
+
+template<typename T, typename Bits, typename Parser>
+static bool parseFloatImpl(std::string_view text, T& number, Parser parser) {
+  // NOTE leading whitespace is skipped as strto* does
+  while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) text.remove_prefix(1);
+
+  // NOTE strto* needs NUL-terminated text
+  std::array<char, 64> buffer;
+  DecimalText decimal;
+  if (!scanDecimal(text, decimal)) {
+    // NOTE infinity, NaN and hexadecimal numbers
+    if (text.empty() || text.size() >= buffer.size()) return false;
+    std::copy(text.begin(), text.end(), buffer.data());
+    buffer[text.size()] = '\0';
+    return parseWithFallback(buffer.data(), number, parser);
+  }
+
+  if constexpr (!std::is_same_v<Bits, void>) {
+    uint64_t significand = 0;
+    const Significand digits = readSignificand(
+      decimal.mantissa, MAX_SIGNIFICAND_DIGITS, [&significand](char c) { significand = significand * 10 + (c - '0'); });
+    // NOTE significand rounded to the nearest has error of half a unit at most
+    if (digits.isRoundedUp) significand++;
+    T parsed;
+    if (decimalToFloat<T, Bits>(
+          significand, digits.digitCount, digits.exponent + decimal.exponent, digits.isTruncated, parsed)) {
+      if (std::isinf(parsed)) return false;
+      number = decimal.isNegative ? -parsed : parsed;
+      return true;
+    }
+  }
+
+  // NOTE long text is shortened to significant digits and a sticky digit which keeps it off the middle between
+  // truncated numbers, the result differs only for crafted text with more than 40 significant digits
+  std::size_t size = 0;
+  if (decimal.isNegative) buffer[size++] = '-';
+  const Significand digits =
+    readSignificand(decimal.mantissa, MAX_FALLBACK_DIGITS, [&buffer, &size](char c) { buffer[size++] = c; });
+  int exponent = digits.exponent + decimal.exponent;
+  if (digits.digitCount == 0) buffer[size++] = '0';
+  if (digits.isTruncated) {
+    buffer[size++] = '1';
+    exponent--;
+  }
+  std::snprintf(buffer.data() + size, buffer.size() - size, "e%d", exponent);
+  return parseWithFallback(buffer.data(), number, parser);
+}
+
+bool parseFloat(std::string_view text, double& number) {
+  return parseFloatImpl<double, uint64_t>(
+    text, number, [](const char* begin, char** end) { return std::strtod(begin, end); });
+}
+
+bool parseFloat(std::string_view text, float& number) {
+  return parseFloatImpl<float, uint32_t>(
+    text, number, [](const char* begin, char** end) { return std::strtof(begin, end); });
+}
+
+bool parseFloat(std::string_view text, long double& number) {
+  // NOTE long double has no fast path, its format depends on the target
+  return parseFloatImpl<long double, void>(
+    text, number, [](const char* begin, char** end) { return std::strtold(begin, end); });
+}
+
+}
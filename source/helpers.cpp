@@ -0,0 +1,34 @@
+#include "essentials/helpers.hpp"
+
+#include <array>
+
+namespace essentials {
+
+uint32_t crc32(Span<uint8_t> data, uint32_t crc) {
+  // NOTE half-byte table keeps flash footprint small
+  static constexpr std::array<uint32_t, 16> table{0x00000000,
+    0x1db71064,
+    0x3b6e20c8,
+    0x26d930ac,
+    0x76dc4190,
+    0x6b6b51f4,
+    0x4db26158,
+    0x5005713c,
+    0xedb88320,
+    0xf00f9344,
+    0xd6d6a3e8,
+    0xcb61b38c,
+    0x9b64c2b0,
+    0x86d3d2d4,
+    0xa00ae278,
+    0xbdbdf21c};
+
+  crc = ~crc;
+  for (std::size_t i = 0; i < data.size; i++) {
+    crc = table[(crc ^ data.data[i]) & 0x0f] ^ (crc >> 4);
+    crc = table[(crc ^ (data.data[i] >> 4)) & 0x0f] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
+}
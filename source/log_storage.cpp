@@ -0,0 +1,446 @@
+#include "essentials/log_storage.hpp"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace essentials {
+
+struct LogStorage::Private {
+  struct SectorHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t crc;
+  };
+
+  struct RecordHeader {
+    uint16_t magic;
+    uint8_t keySize;
+    uint8_t reserved;
+    uint32_t dataSize;
+    uint32_t crc;
+  };
+
+  struct Sector {
+    bool isUsed;
+    bool isErased;
+    uint32_t sequence;
+    std::size_t usedBytes;
+    std::size_t liveBytes;
+  };
+
+  struct Location {
+    std::size_t sector;
+    std::size_t offset;
+    uint32_t dataSize;
+  };
+
+  static constexpr uint32_t SECTOR_MAGIC = 0x53474f4c;
+  static constexpr uint16_t RECORD_MAGIC = 0x4552;
+  static constexpr std::size_t ALIGNMENT = 4;
+  static constexpr std::size_t RESERVED_SECTORS = 2;
+
+  Partition& partition;
+  const std::size_t sectorSize;
+  const std::size_t sectorCount;
+  std::vector<Sector> sectors;
+  std::unordered_map<StorageKey, Location, StorageKey::Hash> index{};
+  std::size_t head = 0;
+  std::size_t headOffset = 0;
+  uint32_t nextSequence = 0;
+  Stats stats{};
+
+  mutable std::mutex mutex{};
+  std::condition_variable compactionCondition{};
+  std::thread compactionThread{};
+  bool isStopping = false;
+
+  Private(Partition& partition, bool isCompactedInBackground) :
+    partition(partition),
+    sectorSize(partition.sectorSize()),
+    sectorCount(partition.size() / partition.sectorSize()),
+    sectors(sectorCount, Sector{false, false, 0, 0, 0}) {
+    if (sectorCount < RESERVED_SECTORS + 1) {
+      throw std::runtime_error("log storage needs at least 3 sectors");
+    }
+    mount();
+
+    if (isCompactedInBackground) {
+      compactionThread = std::thread{[this]() { compactInBackground(); }};
+    }
+  }
+
+  ~Private() {
+    if (compactionThread.joinable()) {
+      {
+        std::lock_guard lock{mutex};
+        isStopping = true;
+      }
+      compactionCondition.notify_one();
+      compactionThread.join();
+    }
+  }
+
+  static std::size_t recordSize(std::size_t keySize, std::size_t dataSize) {
+    return (sizeof(RecordHeader) + keySize + dataSize + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  }
+
+  static bool isErased(Span<uint8_t> data) {
+    return std::all_of(data.data, data.data + data.size, [](uint8_t byte) { return byte == 0xff; });
+  }
+
+  std::size_t sectorAddress(std::size_t sector) const {
+    return sector * sectorSize;
+  }
+
+  std::size_t freeSectorCount() const {
+    return std::count_if(sectors.begin(), sectors.end(), [](const Sector& sector) { return !sector.isUsed; });
+  }
+
+  /**
+   * @brief Background compaction runs when the next head would take a reserved sector and it can free a sector
+   */
+  bool isBackgroundCompactionNeeded() const {
+    // NOTE small partitions always have few free sectors, without a sector of garbage compaction only erases
+    if (freeSectorCount() > RESERVED_SECTORS + 1) return false;
+    std::size_t garbageBytes = 0;
+    for (const Sector& sector : sectors) garbageBytes += sector.usedBytes - sector.liveBytes;
+    return garbageBytes >= sectorCapacity();
+  }
+
+  void mount() {
+    std::vector<std::size_t> usedSectors;
+    for (std::size_t sector = 0; sector < sectorCount; sector++) {
+      SectorHeader header;
+      partition.read(sectorAddress(sector), MutableSpan<uint8_t>{reinterpret_cast<uint8_t*>(&header), sizeof(header)});
+      const uint32_t crc = crc32(Span<uint8_t>{reinterpret_cast<const uint8_t*>(&header), offsetof(SectorHeader, crc)});
+      if (header.magic == SECTOR_MAGIC && header.crc == crc) {
+        sectors[sector] = Sector{true, false, header.sequence, 0, 0};
+        usedSectors.push_back(sector);
+      }
+    }
+
+    std::sort(usedSectors.begin(), usedSectors.end(), [this](std::size_t left, std::size_t right) {
+      return sectors[left].sequence < sectors[right].sequence;
+    });
+
+    std::size_t endOffset = 0;
+    for (std::size_t sector : usedSectors) {
+      endOffset = replay(sector);
+    }
+
+    if (usedSectors.empty()) {
+      openSector(0);
+    } else {
+      nextSequence = sectors[usedSectors.back()].sequence + 1;
+      head = usedSectors.back();
+      headOffset = endOffset;
+    }
+
+    // NOTE power loss might interrupt compaction, finish it to get free sectors back in reserve
+    restoreReserve();
+  }
+
+  /**
+   * @brief Add sector's records into index
+   *
+   * @return std::size_t offset behind the last valid record or sector size if sector contains a broken record
+   */
+  std::size_t replay(std::size_t sector) {
+    std::size_t offset = sizeof(SectorHeader);
+    while (offset + sizeof(RecordHeader) <= sectorSize) {
+      RecordHeader header;
+      partition.read(
+        sectorAddress(sector) + offset, MutableSpan<uint8_t>{reinterpret_cast<uint8_t*>(&header), sizeof(header)});
+      if (isErased(Span<uint8_t>{reinterpret_cast<const uint8_t*>(&header), sizeof(header)})) return offset;
+
+      const std::size_t size = recordSize(header.keySize, header.dataSize);
+      if (header.magic != RECORD_MAGIC || header.keySize == 0 || header.keySize > StorageKey::MAX_LENGTH ||
+          offset + size > sectorSize) {
+        return sectorSize;
+      }
+
+      std::array<char, StorageKey::MAX_LENGTH> key;
+      const std::size_t keyAddress = sectorAddress(sector) + offset + sizeof(RecordHeader);
+      partition.read(keyAddress, MutableSpan<uint8_t>{reinterpret_cast<uint8_t*>(key.data()), header.keySize});
+      if (header.crc != recordCrc(keyAddress, header.keySize + header.dataSize)) return sectorSize;
+
+      addToIndex(StorageKey{std::string_view{key.data(), header.keySize}},
+        Location{sector, offset, header.dataSize},
+        size);
+      offset += size;
+    }
+    return offset;
+  }
+
+  uint32_t recordCrc(std::size_t address, std::size_t size) const {
+    std::array<uint8_t, 64> chunk;
+    uint32_t crc = 0;
+    for (std::size_t done = 0; done < size; done += chunk.size()) {
+      const std::size_t chunkSize = std::min(chunk.size(), size - done);
+      partition.read(address + done, MutableSpan<uint8_t>{chunk.data(), chunkSize});
+      crc = crc32(Span<uint8_t>{chunk.data(), chunkSize}, crc);
+    }
+    return crc;
+  }
+
+  void addToIndex(const StorageKey& key, Location location, std::size_t size) {
+    auto [it, isInserted] = index.try_emplace(key, location);
+    if (!isInserted) {
+      sectors[it->second.sector].liveBytes -= recordSize(key.view().size(), it->second.dataSize);
+      it->second = location;
+    }
+    sectors[location.sector].usedBytes += size;
+    sectors[location.sector].liveBytes += size;
+  }
+
+  void eraseSector(std::size_t sector) {
+    partition.erase(sectorAddress(sector), sectorSize);
+    stats.sectorErases++;
+    sectors[sector] = Sector{false, true, 0, 0, 0};
+  }
+
+  void openSector(std::size_t sector) {
+    if (!sectors[sector].isErased) eraseSector(sector);
+
+    SectorHeader header{SECTOR_MAGIC, nextSequence++, 0};
+    header.crc = crc32(Span<uint8_t>{reinterpret_cast<const uint8_t*>(&header), offsetof(SectorHeader, crc)});
+    program(sectorAddress(sector), Span<uint8_t>{reinterpret_cast<const uint8_t*>(&header), sizeof(header)});
+
+    sectors[sector] = Sector{true, false, header.sequence, 0, 0};
+    head = sector;
+    headOffset = sizeof(SectorHeader);
+  }
+
+  void openNextSector() {
+    // NOTE take free sectors in round-robin order to spread wear
+    for (std::size_t i = 1; i <= sectorCount; i++) {
+      const std::size_t sector = (head + i) % sectorCount;
+      if (!sectors[sector].isUsed) {
+        openSector(sector);
+        return;
+      }
+    }
+    throw std::runtime_error("log storage has no free sector");
+  }
+
+  void program(std::size_t address, Span<uint8_t> data) {
+    partition.write(address, data);
+    stats.bytesWritten += data.size;
+  }
+
+  std::size_t oldestSector() const {
+    std::size_t oldest = head;
+    for (std::size_t sector = 0; sector < sectorCount; sector++) {
+      if (sector == head || !sectors[sector].isUsed) continue;
+      if (oldest == head || sectors[sector].sequence < sectors[oldest].sequence) oldest = sector;
+    }
+    return oldest;
+  }
+
+  /**
+   * @brief Move live records of the oldest sector to the head and erase it. Head must have space for them.
+   */
+  void compactOldest() {
+    const std::size_t victim = oldestSector();
+    if (victim == head) throw std::runtime_error("log storage has no sector to compact");
+    if (sectors[victim].liveBytes > sectorSize - headOffset) throw std::runtime_error("log storage is full");
+
+    for (auto& [key, location] : index) {
+      if (location.sector != victim) continue;
+
+      const std::size_t size = recordSize(key.view().size(), location.dataSize);
+      const std::size_t from = sectorAddress(victim) + location.offset;
+      const std::size_t to = sectorAddress(head) + headOffset;
+      std::array<uint8_t, 64> chunk;
+      const std::size_t rawSize = sizeof(RecordHeader) + key.view().size() + location.dataSize;
+      for (std::size_t done = 0; done < rawSize; done += chunk.size()) {
+        const std::size_t chunkSize = std::min(chunk.size(), rawSize - done);
+        partition.read(from + done, MutableSpan<uint8_t>{chunk.data(), chunkSize});
+        program(to + done, Span<uint8_t>{chunk.data(), chunkSize});
+      }
+
+      location = Location{head, headOffset, location.dataSize};
+      sectors[head].usedBytes += size;
+      sectors[head].liveBytes += size;
+      headOffset += size;
+    }
+
+    eraseSector(victim);
+    stats.compactions++;
+  }
+
+  std::size_t sectorCapacity() const {
+    return sectorSize - sizeof(SectorHeader);
+  }
+
+  /**
+   * @brief Compact oldest sectors until there are enough free sectors for next head and for compaction itself
+   */
+  void restoreReserve() {
+    for (std::size_t attempts = 0; freeSectorCount() < RESERVED_SECTORS && attempts < sectorCount; attempts++) {
+      const std::size_t victim = oldestSector();
+      if (victim == head) return;
+      if (sectors[victim].liveBytes > sectorSize - headOffset) {
+        if (freeSectorCount() == 0) return;
+        openNextSector();
+      }
+      compactOldest();
+    }
+  }
+
+  void ensureSpace(std::size_t size) {
+    std::size_t attempts = 0;
+    while (headOffset + size > sectorSize) {
+      if (attempts++ > sectorCount || freeSectorCount() == 0) throw std::runtime_error("log storage is full");
+
+      openNextSector();
+      restoreReserve();
+    }
+  }
+
+  void write(const StorageKey& key, Span<uint8_t> data) {
+    const std::size_t keySize = key.view().size();
+    const std::size_t size = recordSize(keySize, data.size);
+    if (size > sectorCapacity()) {
+      throw std::runtime_error("data is too big for log storage sector");
+    }
+    ensureSpace(size);
+
+    RecordHeader header{RECORD_MAGIC, uint8_t(keySize), 0, uint32_t(data.size), 0};
+    header.crc = crc32(data, crc32(Span<uint8_t>{reinterpret_cast<const uint8_t*>(key.c_str()), keySize}));
+
+    // NOTE header goes first, record interrupted by power loss is detected by CRC
+    const std::size_t address = sectorAddress(head) + headOffset;
+    program(address, Span<uint8_t>{reinterpret_cast<const uint8_t*>(&header), sizeof(header)});
+    program(address + sizeof(header), Span<uint8_t>{reinterpret_cast<const uint8_t*>(key.c_str()), keySize});
+    if (data.size > 0) program(address + sizeof(header) + keySize, data);
+
+    addToIndex(key, Location{head, headOffset, uint32_t(data.size)}, size);
+    headOffset += size;
+
+    if (compactionThread.joinable() && isBackgroundCompactionNeeded()) {
+      compactionCondition.notify_one();
+    }
+  }
+
+  bool compact() {
+    const std::size_t victim = oldestSector();
+    if (victim == head || sectors[victim].liveBytes == sectors[victim].usedBytes) return false;
+    if (sectors[victim].liveBytes > sectorSize - headOffset) openNextSector();
+    compactOldest();
+    return true;
+  }
+
+  void compactInBackground() {
+    std::unique_lock lock{mutex};
+    while (!isStopping) {
+      compactionCondition.wait(lock, [this]() { return isStopping || isBackgroundCompactionNeeded(); });
+      if (isStopping) break;
+
+      bool isCompacted = false;
+      try {
+        isCompacted = compact();
+      } catch (const std::exception&) {
+        isCompacted = false;
+      }
+      if (!isCompacted) {
+        // NOTE nothing to reclaim now, wait for next write
+        compactionCondition.wait(lock);
+      }
+    }
+  }
+
+  int readInto(const StorageKey& key, MutableSpan<uint8_t> buffer) const {
+    auto it = index.find(key);
+    if (it == index.end()) return -1;
+
+    const Location& location = it->second;
+    if (location.dataSize <= buffer.size) {
+      const std::size_t address =
+        sectorAddress(location.sector) + location.offset + sizeof(RecordHeader) + key.view().size();
+      partition.read(address, MutableSpan<uint8_t>{buffer.data, location.dataSize});
+    }
+    return location.dataSize;
+  }
+
+  void clear() {
+    for (std::size_t sector = 0; sector < sectorCount; sector++) {
+      if (!sectors[sector].isErased) eraseSector(sector);
+    }
+    index.clear();
+    nextSequence = 0;
+    openSector(0);
+  }
+};
+
+LogStorage::LogStorage(Partition& partition, bool isCompactedInBackground) :
+  p(std::make_unique<Private>(partition, isCompactedInBackground)) {
+}
+
+LogStorage::~LogStorage() = default;
+
+int LogStorage::size(const StorageKey& key) const {
+  std::lock_guard lock{p->mutex};
+  auto it = p->index.find(key);
+  if (it == p->index.end()) return -1;
+  return it->second.dataSize;
+}
+
+std::vector<uint8_t> LogStorage::read(const StorageKey& key, int size) const {
+  auto buffer = std::vector<uint8_t>{};
+  buffer.resize(size);
+
+  std::lock_guard lock{p->mutex};
+  int storedSize = p->readInto(key, MutableSpan<uint8_t>{buffer.data(), buffer.size()});
+  if (storedSize < 0) {
+    buffer.clear();
+    return buffer;
+  }
+  if (storedSize > size) {
+    throw std::runtime_error("stored data is bigger than requested size");
+  }
+  return buffer;
+}
+
+int LogStorage::readInto(const StorageKey& key, MutableSpan<uint8_t> buffer) const {
+  std::lock_guard lock{p->mutex};
+  return p->readInto(key, buffer);
+}
+
+void LogStorage::write(const StorageKey& key, Span<uint8_t> data) {
+  std::lock_guard lock{p->mutex};
+  p->write(key, data);
+}
+
+void LogStorage::clear() {
+  std::lock_guard lock{p->mutex};
+  p->clear();
+}
+
+std::vector<StorageKey> LogStorage::keys() const {
+  std::lock_guard lock{p->mutex};
+  std::vector<StorageKey> keys;
+  keys.reserve(p->index.size());
+  for (const auto& [key, location] : p->index) {
+    keys.push_back(key);
+  }
+  return keys;
+}
+
+bool LogStorage::compact() {
+  std::lock_guard lock{p->mutex};
+  return p->compact();
+}
+
+LogStorage::Stats LogStorage::stats() const {
+  std::lock_guard lock{p->mutex};
+  return p->stats;
+}
+
+}
@@ -0,0 +1,130 @@
+#include "essentials/lz.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace essentials {
+
+// NOTE sequence: [token: literal length 4b | match length 4b] [literal length extension] [literals]
+// [match offset u16] [match length extension], last sequence has only literals
+static constexpr std::size_t LZ_MIN_MATCH = 4;
+static constexpr std::size_t LZ_MAX_OFFSET = 0xffff;
+static constexpr uint32_t LZ_NO_POSITION = 0xffffffff;
+
+static uint32_t lzRead32(const uint8_t* data) {
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static bool lzWriteLength(MutableSpan<uint8_t> output, std::size_t& position, std::size_t length) {
+  while (length >= 255) {
+    if (position >= output.size) return false;
+    output.data[position++] = 255;
+    length -= 255;
+  }
+  if (position >= output.size) return false;
+  output.data[position++] = length;
+  return true;
+}
+
+static bool lzReadLength(Span<uint8_t> input, std::size_t& position, std::size_t& length) {
+  uint8_t byte = 255;
+  while (byte == 255) {
+    if (position >= input.size) return false;
+    byte = input.data[position++];
+    length += byte;
+  }
+  return true;
+}
+
+static bool lzWriteSequence(MutableSpan<uint8_t> output,
+  std::size_t& position,
+  Span<uint8_t> literals,
+  std::size_t offset,
+  std::size_t matchLength) {
+  if (position >= output.size) return false;
+  const std::size_t tokenMatchLength = matchLength == 0 ? 0 : matchLength - LZ_MIN_MATCH;
+  uint8_t& token = output.data[position++];
+  token = (std::min<std::size_t>(literals.size, 15) << 4) | std::min<std::size_t>(tokenMatchLength, 15);
+
+  if (literals.size >= 15 && !lzWriteLength(output, position, literals.size - 15)) return false;
+  if (output.size - position < literals.size) return false;
+  std::copy(literals.data, literals.data + literals.size, output.data + position);
+  position += literals.size;
+
+  if (matchLength == 0) return true;
+  if (output.size - position < 2) return false;
+  output.data[position++] = offset & 0xff;
+  output.data[position++] = offset >> 8;
+  return tokenMatchLength < 15 || lzWriteLength(output, position, tokenMatchLength - 15);
+}
+
+std::size_t lzCompress(Span<uint8_t> input, MutableSpan<uint8_t> output, LzHashTable& table) {
+  table.fill(LZ_NO_POSITION);
+
+  std::size_t outputPosition = 0;
+  std::size_t anchor = 0;
+  std::size_t position = 0;
+  while (position + LZ_MIN_MATCH <= input.size) {
+    const uint32_t sequence = lzRead32(input.data + position);
+    uint32_t& entry = table[(sequence * 2654435761u) >> 22];
+    const uint32_t candidate = entry;
+    entry = position;
+
+    if (candidate == LZ_NO_POSITION || position - candidate > LZ_MAX_OFFSET ||
+      lzRead32(input.data + candidate) != sequence) {
+      position++;
+      continue;
+    }
+
+    const uint8_t* match = input.data + candidate;
+    const uint8_t* current = input.data + position;
+    std::size_t matchLength = LZ_MIN_MATCH;
+    while (position + matchLength < input.size && match[matchLength] == current[matchLength]) {
+      matchLength++;
+    }
+    Span<uint8_t> literals{input.data + anchor, position - anchor};
+    if (!lzWriteSequence(output, outputPosition, literals, position - candidate, matchLength)) return 0;
+    position += matchLength;
+    anchor = position;
+  }
+
+  Span<uint8_t> literals{input.data + anchor, input.size - anchor};
+  if (!lzWriteSequence(output, outputPosition, literals, 0, 0)) return 0;
+  return outputPosition;
+}
+
+int lzDecompress(Span<uint8_t> input, MutableSpan<uint8_t> output) {
+  std::size_t position = 0;
+  std::size_t outputPosition = 0;
+  while (position < input.size) {
+    const uint8_t token = input.data[position++];
+
+    std::size_t literalLength = token >> 4;
+    if (literalLength == 15 && !lzReadLength(input, position, literalLength)) return -1;
+    if (input.size - position < literalLength || output.size - outputPosition < literalLength) return -1;
+    std::copy(input.data + position, input.data + position + literalLength, output.data + outputPosition);
+    position += literalLength;
+    outputPosition += literalLength;
+    if (position == input.size) break;
+
+    if (input.size - position < 2) return -1;
+    const std::size_t offset = input.data[position] | (input.data[position + 1] << 8);
+    position += 2;
+    std::size_t matchLength = token & 0x0f;
+    if (matchLength == 15 && !lzReadLength(input, position, matchLength)) return -1;
+    matchLength += LZ_MIN_MATCH;
+    if (offset == 0 || offset > outputPosition || output.size - outputPosition < matchLength) return -1;
+
+    // NOTE match may overlap its own output thus it is copied byte by byte
+    const uint8_t* match = output.data + outputPosition - offset;
+    for (std::size_t i = 0; i < matchLength; i++) {
+      output.data[outputPosition + i] = match[i];
+    }
+    outputPosition += matchLength;
+  }
+  return outputPosition;
+}
+
+}
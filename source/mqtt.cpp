@@ -1,13 +1,341 @@
 #include "essentials/mqtt.hpp"
 
+#include "essentials/left_right.hpp"
+#include "essentials/periodic_task.hpp"
+#include "essentials/spsc_queue.hpp"
+#include "essentials/topic_trie.hpp"
+
 #include "esp_log.h"
+#include "esp_pthread.h"
+#include "esp_timer.h"
 #include "mqtt_client.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
 namespace essentials {
 
 const char* TAG_MQTT = "mqtt";
 
+struct Mqtt::Subscription::State {
+  // NOTE key of broker topic, it exists until the state stops counting in it
+  std::string_view topic;
+  Qos qos;
+  Reaction reaction;
+  // NOTE owner is reached only while state is active and subscribers table is read, it isn't destroyed meanwhile
+  Subscription* owner;
+  std::atomic<bool> isActive = true;
+};
+
+// NOTE set on MQTT client's task while it delivers a message of the client to subscribers
+thread_local const void* deliveringMqtt = nullptr;
+
+/**
+ * @brief Free list of equally sized memory blocks. Blocks are allocated when the list is empty and returned blocks are
+ * reused, they are never freed.
+ */
+class BlockPool {
+public:
+  explicit BlockPool(std::size_t blockSize) : _blockSize(blockSize) {
+  }
+
+  ~BlockPool() {
+    for (void* block : _free) ::operator delete(block);
+  }
+
+  void* acquire(std::size_t size) {
+    if (size > _blockSize) throw std::runtime_error("block pool's block is too small");
+    std::lock_guard lock{_mutex};
+    if (_free.empty()) _grow(1);
+    void* block = _free.back();
+    _free.pop_back();
+    return block;
+  }
+
+  void release(void* block) {
+    std::lock_guard lock{_mutex};
+    // NOTE free list has capacity for all blocks thus it doesn't allocate
+    _free.push_back(block);
+  }
+
+  void reserve(std::size_t count) {
+    std::lock_guard lock{_mutex};
+    if (count > _free.size()) _grow(count - _free.size());
+  }
+
+private:
+  std::size_t _blockSize;
+  std::size_t _blockCount = 0;
+  std::vector<void*> _free{};
+  std::mutex _mutex{};
+
+  void _grow(std::size_t count) {
+    _blockCount += count;
+    _free.reserve(_blockCount);
+    for (std::size_t i = 0; i < count; i++) {
+      _free.push_back(::operator new(_blockSize));
+    }
+  }
+};
+
+BlockPool& subscriptionPool() {
+  static BlockPool pool{sizeof(Mqtt::Subscription)};
+  return pool;
+}
+
+/**
+ * @brief Allocator of std::allocate_shared which takes blocks from a pool
+ */
+template<typename T>
+struct PoolAllocator {
+  using value_type = T;
+
+  BlockPool* pool;
+
+  explicit PoolAllocator(BlockPool& pool) : pool(&pool) {
+  }
+
+  template<typename U>
+  PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {
+  }
+
+  T* allocate(std::size_t count) {
+    return static_cast<T*>(pool->acquire(count * sizeof(T)));
+  }
+
+  void deallocate(T* pointer, std::size_t) {
+    pool->release(pointer);
+  }
+
+  template<typename U>
+  bool operator==(const PoolAllocator<U>& other) const {
+    return pool == other.pool;
+  }
+
+  template<typename U>
+  bool operator!=(const PoolAllocator<U>& other) const {
+    return pool != other.pool;
+  }
+};
+
+/**
+ * @brief Local subscriptions of one prefixed topic, broker is subscribed once with their highest QoS
+ */
+struct BrokerTopic {
+  std::array<uint16_t, 3> counts{};
+  // NOTE QoS of the last SUBSCRIBE sent to broker, empty when broker isn't subscribed
+  std::optional<Mqtt::Qos> sentQos{};
+  // NOTE message id of the last SUBSCRIBE or UNSUBSCRIBE until broker acknowledges it
+  int pendingMessageId = -1;
+  // NOTE broker may have missed the last SUBSCRIBE or UNSUBSCRIBE, it is sent again
+  bool isUncertain = false;
+
+  bool isSynced() const {
+    return !isUncertain && requestedQos() == sentQos;
+  }
+
+  bool isUnused() const {
+    return isSynced() && !sentQos && pendingMessageId < 0;
+  }
+
+  std::optional<Mqtt::Qos> requestedQos() const {
+    for (std::size_t i = counts.size(); i > 0; i--) {
+      if (counts[i - 1] > 0) return Mqtt::Qos(i - 1);
+    }
+    return std::nullopt;
+  }
+};
+
+/**
+ * @brief Worker threads running reactions of messages posted from MQTT client's task
+ */
+struct Dispatcher {
+  static constexpr std::size_t PRIORITY_COUNT = 3;
+
+  struct Message {
+    std::shared_ptr<Mqtt::Subscription::State> subscriber{};
+    BufferPool::Buffer buffer{};
+    std::size_t size = 0;
+    int32_t offset = 0;
+    int32_t totalLength = 0;
+  };
+
+  struct Worker {
+    // NOTE queues are filled only by MQTT client's task and emptied only by the worker
+    std::vector<std::unique_ptr<SpscQueue<Message>>> queues{};
+    BufferPool pool;
+    std::mutex mutex{};
+    std::condition_variable condition{};
+    // NOTE set under mutex before the worker waits, posting takes mutex only to wake a sleeping worker
+    std::atomic<bool> isSleeping = false;
+    // NOTE subscriber whose reaction runs, unsubscribe waits only for its own subscriber thus reactions on different
+    // workers can destroy subscriptions served by each other
+    std::mutex runMutex{};
+    std::condition_variable runCondition{};
+    const Mqtt::Subscription::State* running = nullptr;
+    std::thread thread{};
+
+    Worker(std::size_t queueDepth, std::size_t messageSize) : pool(PRIORITY_COUNT * queueDepth, messageSize) {
+      for (std::size_t i = 0; i < PRIORITY_COUNT; i++) {
+        queues.push_back(std::make_unique<SpscQueue<Message>>(queueDepth));
+      }
+    }
+
+    bool hasMessages() const {
+      return std::any_of(queues.begin(), queues.end(), [](const auto& queue) { return !queue->empty(); });
+    }
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers{};
+  std::atomic<bool> isStopping = false;
+  std::atomic<uint32_t> posted = 0;
+  std::atomic<uint32_t> dispatched = 0;
+  std::atomic<uint32_t> dropped = 0;
+  std::atomic<uint32_t> maxDepth = 0;
+
+  Dispatcher(std::size_t workerCount,
+    std::size_t queueDepth,
+    std::size_t messageSize,
+    std::size_t stackSize,
+    int taskPriority) {
+    for (std::size_t i = 0; i < workerCount; i++) {
+      workers.push_back(std::make_unique<Worker>(queueDepth, messageSize));
+    }
+
+    // NOTE pthread config applies to threads created by the calling task thus previous config is restored
+    esp_pthread_cfg_t previousConfig;
+    const bool hasPreviousConfig = esp_pthread_get_cfg(&previousConfig) == ESP_OK;
+    esp_pthread_cfg_t config = esp_pthread_get_default_config();
+    config.stack_size = stackSize;
+    config.prio = taskPriority;
+    config.thread_name = TAG_MQTT;
+    esp_pthread_set_cfg(&config);
+    for (auto& worker : workers) {
+      worker->thread = std::thread{[this, worker = worker.get()]() { run(*worker); }};
+    }
+    if (hasPreviousConfig) esp_pthread_set_cfg(&previousConfig);
+  }
+
+  ~Dispatcher() {
+    isStopping = true;
+    for (auto& worker : workers) {
+      {
+        std::lock_guard lock{worker->mutex};
+      }
+      worker->condition.notify_one();
+      worker->thread.join();
+    }
+  }
+
+  void post(const std::shared_ptr<Mqtt::Subscription::State>& subscriber, const Mqtt::Data& data) {
+    posted++;
+    Worker& worker = workerOf(*subscriber);
+    Message message{subscriber, worker.pool.acquire(), data.data.size(), data.offset, data.totalLength};
+    if (!message.buffer || data.data.size() > message.buffer.size()) {
+      dropped++;
+      return;
+    }
+    std::copy(data.data.begin(), data.data.end(), message.buffer.data());
+
+    SpscQueue<Message>& queue = *worker.queues[std::size_t(subscriber->owner->priority.load())];
+    if (!queue.push(std::move(message))) {
+      dropped++;
+      return;
+    }
+
+    const uint32_t depth = this->depth();
+    uint32_t currentMax = maxDepth.load();
+    while (depth > currentMax && !maxDepth.compare_exchange_weak(currentMax, depth)) {
+    }
+
+    // NOTE fences pair with the worker's, either it sees the pushed message or this sees it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (worker.isSleeping) {
+      std::lock_guard lock{worker.mutex};
+      worker.condition.notify_one();
+    }
+  }
+
+  void run(Worker& worker) {
+    Message message{};
+    while (true) {
+      if (!popHighest(worker, message)) {
+        std::unique_lock lock{worker.mutex};
+        worker.isSleeping = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        worker.condition.wait(lock, [this, &worker]() { return isStopping || worker.hasMessages(); });
+        worker.isSleeping = false;
+        if (isStopping) return;
+        continue;
+      }
+
+      {
+        std::lock_guard lock{worker.runMutex};
+        worker.running = message.subscriber.get();
+      }
+      // NOTE subscriber is checked after it was marked as running, thus unsubscribe either waits for the reaction or
+      // the reaction doesn't run
+      if (message.subscriber->isActive) {
+        const char* data = reinterpret_cast<const char*>(message.buffer.data());
+        try {
+          message.subscriber->reaction(
+            Mqtt::Data{std::string_view{data, message.size}, message.offset, message.totalLength});
+        } catch (const std::exception& e) {
+          ESP_LOGE(TAG_MQTT, "Subscription reaction failed: %s", e.what());
+        }
+      }
+      {
+        std::lock_guard lock{worker.runMutex};
+        worker.running = nullptr;
+      }
+      worker.runCondition.notify_all();
+      message = Message{};
+      dispatched++;
+    }
+  }
+
+  static bool popHighest(Worker& worker, Message& message) {
+    for (std::size_t i = PRIORITY_COUNT; i > 0; i--) {
+      if (worker.queues[i - 1]->pop(message)) return true;
+    }
+    return false;
+  }
+
+  Worker& workerOf(const Mqtt::Subscription::State& subscriber) {
+    // NOTE std::hash of a pointer is its address, whose low bits are the same for all pool blocks, thus it is mixed
+    const uint32_t address = uint32_t(reinterpret_cast<std::uintptr_t>(&subscriber) >> 3);
+    return *workers[(address * 2654435761u >> 16) % workers.size()];
+  }
+
+  /**
+   * @brief Wait until reaction of deactivated subscriber returns, after that the subscriber isn't reached by workers
+   */
+  void waitForReaction(const Mqtt::Subscription::State& subscriber) {
+    Worker& worker = workerOf(subscriber);
+    // NOTE reactions of the subscriber run only on its worker, thus none runs while the worker itself unsubscribes
+    if (worker.thread.get_id() == std::this_thread::get_id()) return;
+    std::unique_lock lock{worker.runMutex};
+    worker.runCondition.wait(lock, [&worker, &subscriber]() { return worker.running != &subscriber; });
+  }
+
+  uint32_t depth() const {
+    uint32_t depth = 0;
+    for (const auto& worker : workers) {
+      for (const auto& queue : worker->queues) depth += queue->size();
+    }
+    return depth;
+  }
+};
+
 struct Mqtt::Private {
+  static constexpr std::size_t MAX_STACK_TOPIC_SIZE = 128;
+
   std::string uri;
   std::string_view cert;
   std::string username;
@@ -21,9 +349,46 @@ struct Mqtt::Private {
   std::function<void()> onConnect;
   std::function<void()> onDisconnect;
 
-  std::unordered_multimap<std::string, Subscription*> subscribers;
+  using Subscribers = TopicTrie<std::shared_ptr<Subscription::State>>;
+  // NOTE MQTT client's task matches topics without waiting, subscribe and unsubscribe modify the other instance
+  LeftRight<Subscribers> subscribers{};
+  // NOTE changes made by reactions during delivery, the delivering task can't wait for its own read
+  std::vector<std::pair<std::shared_ptr<Subscription::State>, bool>> deferredChanges{};
+
+  // NOTE MQTT client calls event handler with its API lock held, thus SUBSCRIBE and UNSUBSCRIBE are sent without
+  // holding brokerMutex and only one task sends them
+  std::mutex brokerMutex{};
+  std::map<std::string, BrokerTopic, std::less<>> brokerTopics{};
+  bool isBrokerSyncing = false;
+  bool isBrokerChanged = false;
+  bool isSessionPersistent;
+  std::size_t resubscribeBatchSize = std::numeric_limits<std::size_t>::max();
+  std::chrono::milliseconds resubscribeInterval{};
+  std::unique_ptr<PeriodicTask> resubscribeTask{};
+  bool isResubscribing = false;
+  std::size_t pendingCount = 0;
+  // NOTE acknowledges which came before the syncing task recorded message id of the packet
+  std::vector<int> earlyAcknowledges{};
+  int64_t connectedAt = 0;
+  bool isReady = false;
+  ReconnectStats reconnectStats{};
 
-  std::string topicOfLastData;
+  std::string topicOfLastData{};
+  int32_t bufferSize;
+  std::atomic<std::size_t> maxMessageSize{Mqtt::DEFAULT_MAX_MESSAGE_SIZE};
+  std::atomic<uint32_t> droppedMessages{0};
+  std::unique_ptr<Dispatcher> dispatcherOwner{};
+  std::atomic<Dispatcher*> dispatcher = nullptr;
+
+  std::mutex outboundMutex{};
+  std::optional<OutboundQueue> outbound{};
+  // NOTE set once outbound is created, publish checks it without outboundMutex and locks only to use the queue
+  std::atomic<bool> hasOutbound = false;
+  std::chrono::milliseconds drainInterval{};
+  std::unique_ptr<PeriodicTask> drainTask{};
+  // NOTE copy of the drained message, it is published without holding outboundMutex
+  std::string drainTopic{};
+  std::string drainData{};
 
   Private(std::string_view uri,
     std::string_view cert,
@@ -34,7 +399,8 @@ struct Mqtt::Private {
     std::chrono::seconds keepAlive,
     std::optional<LastWillMessage> lastWillMessage,
     std::function<void()> onConnect,
-    std::function<void()> onDisconnect) :
+    std::function<void()> onDisconnect,
+    bool isSessionPersistent) :
     uri(uri),
     cert(cert),
     username(username),
@@ -43,7 +409,9 @@ struct Mqtt::Private {
     keepAlive(keepAlive),
     lastWillMessage(std::move(lastWillMessage)),
     onConnect(onConnect),
-    onDisconnect(onDisconnect) {
+    onDisconnect(onDisconnect),
+    isSessionPersistent(isSessionPersistent),
+    bufferSize(bufferSize) {
     esp_mqtt_client_config_t config{};
     if (this->lastWillMessage) {
       lwtFullTopic = makeTopic(this->lastWillMessage->topic);
@@ -59,6 +427,7 @@ struct Mqtt::Private {
     config.username = this->username.c_str();
     config.password = this->password.c_str();
     config.keepalive = keepAlive.count();
+    config.disable_clean_session = isSessionPersistent;
 
     ESP_LOGI(TAG_MQTT, "Free memory: %d bytes", esp_get_free_heap_size());
     client = esp_mqtt_client_init(&config);
@@ -66,27 +435,360 @@ struct Mqtt::Private {
     esp_mqtt_client_start(client);
   }
 
+  ~Private() {
+    drainTask.reset();
+    resubscribeTask.reset();
+  }
+
+  void setOutboundQueue(std::size_t capacity,
+    OutboundQueue::DropPolicy dropPolicy,
+    bool isCoalesced,
+    std::chrono::milliseconds drainInterval) {
+    std::lock_guard lock{outboundMutex};
+    if (!drainTask) {
+      drainTask = std::make_unique<PeriodicTask>([this]() { return drain(); }, TAG_MQTT);
+    }
+    drainTask->stop();
+    outbound.emplace(capacity, dropPolicy, isCoalesced);
+    hasOutbound = true;
+    this->drainInterval = drainInterval;
+  }
+
+  void startDrain() {
+    std::lock_guard lock{outboundMutex};
+    if (!outbound || outbound->empty()) return;
+    drainTask->start(drainInterval);
+  }
+
+  /**
+   * @brief Publish the oldest queued message, called by drainTask
+   *
+   * @return true if there are more messages to publish
+   */
+  bool drain() {
+    int qos;
+    bool isRetained;
+    {
+      std::lock_guard lock{outboundMutex};
+      const auto message = outbound->front();
+      if (!message || !isConnected) return false;
+      // NOTE assign reuses capacity of the strings thus draining doesn't allocate in steady state
+      drainTopic.assign(message->topic);
+      drainData.assign(message->data);
+      qos = message->qos;
+      isRetained = message->isRetained;
+    }
+
+    // NOTE MQTT client calls event handler with its API lock held and the handler takes outboundMutex, thus the
+    // mutex isn't held while publishing
+    const int result =
+      esp_mqtt_client_publish(client, drainTopic.c_str(), drainData.data(), drainData.size(), qos, isRetained ? 1 : 0);
+    std::lock_guard lock{outboundMutex};
+    // NOTE message stays queued, drain continues after the next connect
+    if (result < 0) return false;
+    // NOTE the message could be dropped or coalesced meanwhile, a message with the same content was sent anyway
+    const auto message = outbound->front();
+    if (message && message->topic == drainTopic && message->data == drainData) outbound->pop();
+    return !outbound->empty();
+  }
+
   void publish(std::string_view topic, std::string_view data, Qos qos, bool isRetained) {
     std::string prefixedTopic = makeTopic(topic);
-    esp_mqtt_client_publish(client, prefixedTopic.c_str(), data.data(), data.size(), int(qos), isRetained ? 1 : 0);
+    publish(prefixedTopic.c_str(), data, qos, isRetained);
   }
 
-  std::unique_ptr<Subscription> subscribe(std::string_view topic, Qos qos, std::function<void(const Data&)> reaction) {
-    std::string prefixedTopic = makeTopic(topic);
-    if (isConnected) {
-      esp_mqtt_client_subscribe(client, prefixedTopic.c_str(), int(qos));
+  void publish(const char* prefixedTopic, std::string_view data, Qos qos, bool isRetained) {
+    std::unique_lock lock{outboundMutex, std::defer_lock};
+    if (hasOutbound) {
+      lock.lock();
+      // NOTE while older messages are waiting, newer ones are queued after them to keep publish order
+      if (!isConnected || !outbound->empty()) {
+        if (!outbound->push(prefixedTopic, data, int(qos), isRetained)) {
+          ESP_LOGW(TAG_MQTT, "Outbound queue dropped message to %s", prefixedTopic);
+        }
+        return;
+      }
+      lock.unlock();
+    }
+
+    const int result =
+      esp_mqtt_client_publish(client, prefixedTopic, data.data(), data.size(), int(qos), isRetained ? 1 : 0);
+    if (result < 0 && hasOutbound) {
+      lock.lock();
+      outbound->push(prefixedTopic, data, int(qos), isRetained);
     }
+  }
+
+  static BlockPool& statePool() {
+    // NOTE state is allocated together with control block of shared pointer
+    static BlockPool pool{sizeof(Subscription::State) + 4 * sizeof(void*)};
+    return pool;
+  }
+
+  std::unique_ptr<Subscription> subscribe(std::string_view topic, Qos qos, Reaction reaction) {
     auto subscription = std::make_unique<Subscription>();
-    const auto subscriber = subscribers.emplace(prefixedTopic, subscription.get());
-    subscriber->second->qos = qos;
-    subscriber->second->topic = subscriber->first;
-    subscriber->second->_reaction = std::move(reaction);
-    subscriber->second->_unsubscribe = [prefixedTopic, this, subscriber]() {
-      subscribers.erase(subscriber);
-      esp_mqtt_client_unsubscribe(client, prefixedTopic.c_str());
-    };
+    auto state = std::allocate_shared<Subscription::State>(PoolAllocator<Subscription::State>{statePool()});
+    std::array<char, MAX_STACK_TOPIC_SIZE> buffer;
+    std::string longTopic{};
+    state->topic = countBrokerTopic(makeTopic(topic, buffer, longTopic), qos);
+    state->qos = qos;
+    state->reaction = std::move(reaction);
+    state->owner = subscription.get();
+    subscription->topic = state->topic;
+    subscription->qos = qos;
+    subscription->_mqtt = this;
+    subscription->_state = state;
 
-    return std::move(subscription);
+    // NOTE broker is subscribed after subscriber is inserted, thus it doesn't miss the first messages
+    if (deliveringMqtt == this) {
+      deferredChanges.emplace_back(state, true);
+    } else {
+      subscribers.modify([&state](Subscribers& instance) { instance.insert(state->topic, state); });
+    }
+    changeBrokerTopic(state->topic);
+    return subscription;
+  }
+
+  void unsubscribe(const std::shared_ptr<Subscription::State>& subscriber) {
+    subscriber->isActive = false;
+    if (deliveringMqtt == this) {
+      deferredChanges.emplace_back(subscriber, false);
+      return;
+    }
+    // NOTE waits until tasks leave the instance being modified, thus deactivated subscriber's inline reaction returned
+    subscribers.modify([&subscriber](Subscribers& instance) { instance.erase(subscriber->topic, subscriber); });
+    finishUnsubscribe(*subscriber);
+  }
+
+  void finishUnsubscribe(const Subscription::State& subscriber) {
+    if (Dispatcher* dispatcher = this->dispatcher.load()) dispatcher->waitForReaction(subscriber);
+    uncountBrokerTopic(subscriber.topic, subscriber.qos);
+    changeBrokerTopic(subscriber.topic);
+  }
+
+  /**
+   * @return std::string_view key of broker topic, it stays valid until the subscription is uncounted
+   */
+  std::string_view countBrokerTopic(std::string_view topic, Qos qos) {
+    std::lock_guard lock{brokerMutex};
+    auto it = brokerTopics.find(topic);
+    if (it == brokerTopics.end()) it = brokerTopics.emplace(std::string(topic), BrokerTopic{}).first;
+    it->second.counts[std::size_t(qos)]++;
+    return it->first;
+  }
+
+  void uncountBrokerTopic(std::string_view topic, Qos qos) {
+    std::lock_guard lock{brokerMutex};
+    brokerTopics.find(topic)->second.counts[std::size_t(qos)]--;
+  }
+
+  /**
+   * @brief Send changed subscription of topic to broker, topic must be counted or uncounted just now
+   */
+  void changeBrokerTopic(std::string_view topic) {
+    {
+      std::lock_guard lock{brokerMutex};
+      // NOTE topic may be already erased by syncing task, then it was sent
+      auto it = brokerTopics.find(topic);
+      if (it == brokerTopics.end() || it->second.isSynced()) return;
+      // NOTE paced resubscribe sends this change in its next batch
+      if (isResubscribing) {
+        isBrokerChanged = true;
+        return;
+      }
+    }
+    syncBrokerTopics();
+  }
+
+  /**
+   * @brief Send SUBSCRIBE and UNSUBSCRIBE of topics whose requested QoS differs from what broker knows
+   *
+   * @param limit maximum number of sent packets
+   * @return true if all topics were sent
+   */
+  bool syncBrokerTopics(std::size_t limit = std::numeric_limits<std::size_t>::max()) {
+    std::unique_lock lock{brokerMutex};
+    isBrokerChanged = true;
+    // NOTE the syncing task takes this change in its next pass
+    if (isBrokerSyncing) return false;
+
+    isBrokerSyncing = true;
+    std::size_t sentCount = 0;
+    while (isBrokerChanged && isConnected && sentCount < limit) {
+      isBrokerChanged = false;
+      // NOTE only the syncing task erases topics thus the iterator stays valid while the lock is released
+      for (auto it = brokerTopics.begin(); it != brokerTopics.end();) {
+        BrokerTopic& brokerTopic = it->second;
+        if (brokerTopic.isSynced()) {
+          it = brokerTopic.isUnused() ? brokerTopics.erase(it) : std::next(it);
+          continue;
+        }
+        if (sentCount == limit) {
+          isBrokerChanged = true;
+          break;
+        }
+
+        // NOTE esp-mqtt of esp-idf v4.4 has no esp_mqtt_client_subscribe_multiple, thus each topic is sent in its own
+        // packet and a batch of pacing is a number of packets
+        const std::optional<Qos> qos = brokerTopic.requestedQos();
+        brokerTopic.sentQos = qos;
+        brokerTopic.isUncertain = false;
+        lock.unlock();
+        const int result = qos ? esp_mqtt_client_subscribe(client, it->first.c_str(), int(*qos)) :
+                                 esp_mqtt_client_unsubscribe(client, it->first.c_str());
+        lock.lock();
+        if (result < 0) {
+          ESP_LOGW(TAG_MQTT, "Couldn't change subscription of %s", it->first.c_str());
+          brokerTopic.isUncertain = true;
+        } else if (auto early = std::find(earlyAcknowledges.begin(), earlyAcknowledges.end(), result);
+                   early != earlyAcknowledges.end()) {
+          earlyAcknowledges.erase(early);
+        } else {
+          if (brokerTopic.pendingMessageId < 0) pendingCount++;
+          brokerTopic.pendingMessageId = result;
+        }
+        sentCount++;
+        reconnectStats.subscriptionChanges++;
+        ++it;
+      }
+    }
+    isBrokerSyncing = false;
+    earlyAcknowledges.clear();
+    if (isBrokerChanged) return false;
+    updateReadiness();
+    return true;
+  }
+
+  void setResubscribePacing(std::size_t batchSize, std::chrono::milliseconds interval) {
+    std::lock_guard lock{brokerMutex};
+    if (!resubscribeTask) {
+      resubscribeTask = std::make_unique<PeriodicTask>([this]() { return resubscribe(); }, TAG_MQTT);
+    }
+    resubscribeBatchSize = std::max<std::size_t>(batchSize, 1);
+    resubscribeInterval = interval;
+  }
+
+  void startResubscribe(bool isSessionPresent) {
+    {
+      std::lock_guard lock{brokerMutex};
+      reconnectStats.connects++;
+      reconnectStats.timeToReady = std::chrono::microseconds{0};
+      connectedAt = esp_timer_get_time();
+      isReady = false;
+      pendingCount = 0;
+      const bool isSessionResumed = isSessionPersistent && isSessionPresent;
+      if (isSessionResumed) reconnectStats.resumedSessions++;
+      for (auto& [topic, brokerTopic] : brokerTopics) {
+        if (!isSessionResumed) {
+          // NOTE clean session starts without subscriptions
+          brokerTopic.sentQos = std::nullopt;
+          brokerTopic.isUncertain = false;
+        } else if (brokerTopic.pendingMessageId >= 0) {
+          brokerTopic.isUncertain = true;
+        }
+        brokerTopic.pendingMessageId = -1;
+      }
+      isResubscribing = resubscribeTask != nullptr;
+    }
+    if (!resubscribeTask) {
+      syncBrokerTopics();
+      return;
+    }
+
+    resubscribeTask->stop();
+    if (!syncBrokerTopics(resubscribeBatchSize)) {
+      resubscribeTask->start(resubscribeInterval);
+      return;
+    }
+    finishResubscribe();
+  }
+
+  /**
+   * @brief Send the next batch of paced subscriptions, called by resubscribeTask
+   *
+   * @return true if there are more subscriptions to send
+   */
+  bool resubscribe() {
+    if (isConnected && !syncBrokerTopics(resubscribeBatchSize)) return true;
+    finishResubscribe();
+    return false;
+  }
+
+  void finishResubscribe() {
+    std::lock_guard lock{brokerMutex};
+    isResubscribing = false;
+    updateReadiness();
+  }
+
+  void acknowledgeBrokerTopic(int messageId) {
+    std::lock_guard lock{brokerMutex};
+    for (auto& [topic, brokerTopic] : brokerTopics) {
+      if (brokerTopic.pendingMessageId != messageId) continue;
+      brokerTopic.pendingMessageId = -1;
+      pendingCount--;
+      updateReadiness();
+      return;
+    }
+    if (isBrokerSyncing) earlyAcknowledges.push_back(messageId);
+  }
+
+  /**
+   * @brief Measure time to ready once all subscriptions after connect are acknowledged, called with brokerMutex held
+   */
+  void updateReadiness() {
+    if (isReady || !isConnected || isResubscribing || pendingCount > 0) return;
+    isReady = true;
+    reconnectStats.timeToReady = std::chrono::microseconds{esp_timer_get_time() - connectedAt};
+    ESP_LOGI(TAG_MQTT, "Subscriptions ready %lld ms after connect", reconnectStats.timeToReady.count() / 1000);
+  }
+
+  void deliver(const Data& data) {
+    Dispatcher* dispatcher = this->dispatcher.load();
+    deliveringMqtt = this;
+    subscribers.read([this, &data, dispatcher](const Subscribers& instance) {
+      instance.match(topicOfLastData, [&data, dispatcher](const std::shared_ptr<Subscription::State>& subscriber) {
+        // NOTE subscriber could be deactivated by a reaction of the same message
+        if (!subscriber->isActive) return;
+        if (dispatcher) {
+          dispatcher->post(subscriber, data);
+        } else {
+          subscriber->reaction(data);
+        }
+      });
+    });
+    deliveringMqtt = nullptr;
+
+    if (deferredChanges.empty()) return;
+    subscribers.modify([this](Subscribers& instance) {
+      for (const auto& [subscriber, isInserted] : deferredChanges) {
+        if (isInserted) {
+          instance.insert(subscriber->topic, subscriber);
+        } else {
+          instance.erase(subscriber->topic, subscriber);
+        }
+      }
+    });
+    for (const auto& [subscriber, isInserted] : deferredChanges) {
+      if (!isInserted) finishUnsubscribe(*subscriber);
+    }
+    deferredChanges.clear();
+  }
+
+  /**
+   * @brief Prepend topics prefix into buffer, long topic is prepended into string
+   */
+  std::string_view makeTopic(
+    std::string_view topic, std::array<char, MAX_STACK_TOPIC_SIZE>& buffer, std::string& longTopic) {
+    if (topicsPrefix.empty()) return topic;
+    const std::size_t size = topicsPrefix.size() + 1 + topic.size();
+    if (size > buffer.size()) {
+      longTopic = makeTopic(topic);
+      return longTopic;
+    }
+    std::copy(topicsPrefix.begin(), topicsPrefix.end(), buffer.begin());
+    buffer[topicsPrefix.size()] = '/';
+    std::copy(topic.begin(), topic.end(), buffer.begin() + topicsPrefix.size() + 1);
+    return std::string_view{buffer.data(), size};
   }
 
   std::string makeTopic(std::string_view topic) {
@@ -107,9 +809,8 @@ struct Mqtt::Private {
     switch (eventId) {
       case MQTT_EVENT_CONNECTED: {
         p->isConnected = true;
-        for (const auto& [prefixedTopic, subscriber] : p->subscribers) {
-          esp_mqtt_client_subscribe(p->client, prefixedTopic.c_str(), int(subscriber->qos));
-        }
+        p->startResubscribe(event->session_present);
+        p->startDrain();
         if (p->onConnect) p->onConnect();
       } break;
       case MQTT_EVENT_DISCONNECTED:
@@ -117,8 +818,8 @@ struct Mqtt::Private {
         if (shouldCallDisconnectCallback && p->onDisconnect) p->onDisconnect();
         break;
       case MQTT_EVENT_SUBSCRIBED:
-        break;
       case MQTT_EVENT_UNSUBSCRIBED:
+        p->acknowledgeBrokerTopic(event->msg_id);
         break;
       case MQTT_EVENT_PUBLISHED:
         break;
@@ -126,16 +827,11 @@ struct Mqtt::Private {
         // const bool isDataFragmented = event->dup; // NOTE for newer version of esp-idf (currently latest)
         const bool isDataFragmented = event->topic == nullptr; // NOTE for esp-idf v4.4
 
-        const std::string topic =
-          isDataFragmented ? p->topicOfLastData : std::string(event->topic, event->topic + event->topic_len);
-        p->topicOfLastData = topic;
-
-        const auto [begin, end] = p->subscribers.equal_range(topic);
-        Data data{std::string_view(event->data, event->data_len), event->current_data_offset, event->total_data_len};
+        // NOTE assign reuses capacity of the string thus matching doesn't allocate in steady state
+        if (!isDataFragmented) p->topicOfLastData.assign(event->topic, event->topic_len);
 
-        for (auto it = begin; it != end; it++) {
-          it->second->_reaction(data);
-        }
+        p->deliver(
+          Data{std::string_view(event->data, event->data_len), event->current_data_offset, event->total_data_len});
       } break;
       case MQTT_EVENT_ERROR: {
         ESP_LOGE(TAG_MQTT, "MQTT_EVENT_ERROR");
@@ -165,7 +861,8 @@ Mqtt::Mqtt(ConnectionInfo connectionInfo,
   std::optional<LastWillMessage> lastWillMessage,
   std::function<void()> onConnect,
   std::function<void()> onDisconnect,
-  int32_t bufferSize) :
+  int32_t bufferSize,
+  bool isSessionPersistent) :
   p(std::make_unique<Private>(connectionInfo.uri,
     connectionInfo.cert,
     connectionInfo.username,
@@ -175,7 +872,8 @@ Mqtt::Mqtt(ConnectionInfo connectionInfo,
     keepAlive,
     lastWillMessage,
     onConnect,
-    onDisconnect)) {
+    onDisconnect,
+    isSessionPersistent)) {
 }
 Mqtt::~Mqtt() = default;
 
@@ -183,18 +881,219 @@ bool Mqtt::isConnected() const {
   return p->isConnected;
 }
 
-std::unique_ptr<Mqtt::Subscription> Mqtt::subscribe(
-  std::string_view topic, Qos qos, std::function<void(const Data&)> reaction) {
-  return p->subscribe(topic, qos, reaction);
+Mqtt::Topic Mqtt::topic(std::string_view topic) const {
+  return Topic{p->makeTopic(topic)};
+}
+
+Mqtt::Subscription::~Subscription() {
+  if (_mqtt) _mqtt->unsubscribe(_state);
 }
 
-std::unique_ptr<Mqtt::Subscription> Mqtt::subscribe(
-  std::string_view topic, Qos qos, std::function<void(std::string_view)> reaction) {
-  return subscribe(topic, qos, [reaction](const Data& data) { reaction(data.data); });
+void* Mqtt::Subscription::operator new(std::size_t size) {
+  return subscriptionPool().acquire(size);
+}
+
+void Mqtt::Subscription::operator delete(void* pointer) {
+  subscriptionPool().release(pointer);
+}
+
+void Mqtt::reserveSubscriptions(std::size_t count) {
+  subscriptionPool().reserve(count);
+  Private::statePool().reserve(count);
+}
+
+std::unique_ptr<Mqtt::Subscription> Mqtt::_subscribe(std::string_view topic, Qos qos, Reaction reaction) {
+  return p->subscribe(topic, qos, std::move(reaction));
+}
+
+std::optional<std::string_view> Mqtt::Reassembly::append(const Data& data) {
+  const std::size_t totalLength = data.totalLength;
+  if (data.offset == 0 && data.data.size() == totalLength) {
+    if (totalLength > maxSize) {
+      if (dropped) (*dropped)++;
+      return std::nullopt;
+    }
+    return data.data;
+  }
+
+  if (data.offset == 0) {
+    isReceiving = _start(totalLength);
+    received = 0;
+    if (!isReceiving && dropped) (*dropped)++;
+  }
+  if (!isReceiving) return std::nullopt;
+  if (std::size_t(data.offset) != received || received + data.data.size() > totalLength) {
+    ESP_LOGW(TAG_MQTT, "Dropped message with missing fragment");
+    if (dropped) (*dropped)++;
+    release();
+    return std::nullopt;
+  }
+
+  char* buffer = pool ? reinterpret_cast<char*>(pooledBuffer.data()) : ownBuffer.data();
+  std::copy(data.data.begin(), data.data.end(), buffer + received);
+  received += data.data.size();
+  if (received != totalLength) return std::nullopt;
+  return std::string_view{buffer, totalLength};
+}
+
+void Mqtt::Reassembly::release() {
+  isReceiving = false;
+  pooledBuffer.release();
+}
+
+bool Mqtt::Reassembly::_start(std::size_t totalLength) {
+  if (totalLength > maxSize) {
+    ESP_LOGW(TAG_MQTT, "Dropped message of size %u bigger than %u", totalLength, maxSize);
+    return false;
+  }
+  if (!pool) {
+    // NOTE own buffer keeps its capacity thus it allocates only for bigger messages, at most maxSize
+    ownBuffer.resize(totalLength);
+    return true;
+  }
+  if (totalLength > pool->bufferSize()) {
+    ESP_LOGW(TAG_MQTT, "Dropped message of size %u bigger than pool's buffer", totalLength);
+    return false;
+  }
+  pooledBuffer = pool->acquire();
+  if (!pooledBuffer) {
+    ESP_LOGW(TAG_MQTT, "Dropped message because buffer pool is exhausted");
+    return false;
+  }
+  return true;
+}
+
+std::optional<bool> Mqtt::Streaming::append(const Data& data) {
+  const std::size_t totalLength = data.totalLength;
+  if (data.offset == 0) {
+    if (isReceiving) {
+      ESP_LOGW(TAG_MQTT, "Dropped streamed message interrupted by a new one");
+      sink->abort();
+    }
+    const std::size_t trailerSize = integrity == Integrity::Crc32 ? trailer.size() : 0;
+    if (totalLength < trailerSize) return _drop("message is shorter than its CRC");
+
+    payloadSize = totalLength - trailerSize;
+    received = 0;
+    crc = 0;
+    try {
+      sink->begin(payloadSize);
+    } catch (const std::exception& e) {
+      return _drop(e.what());
+    }
+    isReceiving = true;
+  }
+  if (!isReceiving) return std::nullopt;
+  if (std::size_t(data.offset) != received || received + data.data.size() > totalLength) {
+    return _drop("missing fragment");
+  }
+
+  try {
+    _write(data.data);
+  } catch (const std::exception& e) {
+    return _drop(e.what());
+  }
+  if (received != totalLength) return std::nullopt;
+
+  if (integrity == Integrity::Crc32) {
+    const uint32_t expectedCrc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (uint32_t(trailer[3]) << 24);
+    if (expectedCrc != crc) return _drop("CRC mismatch");
+  }
+  try {
+    sink->commit(crc);
+  } catch (const std::exception& e) {
+    return _drop(e.what());
+  }
+  isReceiving = false;
+  return true;
+}
+
+void Mqtt::Streaming::_write(std::string_view data) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+  // NOTE fragment can end with part of the payload and start of the CRC trailer
+  const std::size_t payloadPart = std::min(data.size(), payloadSize - std::min(received, payloadSize));
+  if (payloadPart > 0) {
+    sink->write(Span<uint8_t>{bytes, payloadPart});
+    crc = crc32(Span<uint8_t>{bytes, payloadPart}, crc);
+  }
+  for (std::size_t i = payloadPart; i < data.size(); i++) {
+    trailer[received + i - payloadSize] = bytes[i];
+  }
+  received += data.size();
+}
+
+bool Mqtt::Streaming::_drop(const char* reason) {
+  ESP_LOGW(TAG_MQTT, "Dropped streamed message: %s", reason);
+  isReceiving = false;
+  sink->abort();
+  return false;
 }
 
 void Mqtt::publish(std::string_view topic, std::string_view data, Qos qos, bool isRetained) {
   p->publish(topic, data, qos, isRetained);
 }
 
+void Mqtt::publish(const Topic& topic, std::string_view data, Qos qos, bool isRetained) {
+  p->publish(topic.c_str(), data, qos, isRetained);
+}
+
+void Mqtt::setOutboundQueue(std::size_t capacity,
+  OutboundQueue::DropPolicy dropPolicy,
+  bool isCoalesced,
+  std::chrono::milliseconds drainInterval) {
+  p->setOutboundQueue(capacity, dropPolicy, isCoalesced, drainInterval);
+}
+
+void Mqtt::setDispatchWorkers(
+  std::size_t workerCount, std::size_t queueDepth, std::size_t stackSize, int taskPriority) {
+  if (p->dispatcherOwner) {
+    throw std::runtime_error("dispatch workers are already running");
+  }
+  if (workerCount == 0 || queueDepth == 0) {
+    throw std::runtime_error("dispatch needs at least one worker and queue depth");
+  }
+  p->dispatcherOwner = std::make_unique<Dispatcher>(workerCount, queueDepth, p->bufferSize, stackSize, taskPriority);
+  p->dispatcher = p->dispatcherOwner.get();
+}
+
+void Mqtt::setMaxMessageSize(std::size_t maxSize) {
+  p->maxMessageSize = maxSize;
+}
+
+std::size_t Mqtt::maxMessageSize() const {
+  return p->maxMessageSize;
+}
+
+uint32_t Mqtt::droppedMessages() const {
+  return p->droppedMessages;
+}
+
+std::atomic<uint32_t>* Mqtt::_droppedCounter() const {
+  return &p->droppedMessages;
+}
+
+Mqtt::DispatchStats Mqtt::dispatchStats() const {
+  Dispatcher* dispatcher = p->dispatcher.load();
+  if (!dispatcher) return DispatchStats{};
+  return DispatchStats{dispatcher->posted,
+    dispatcher->dispatched,
+    dispatcher->dropped,
+    dispatcher->depth(),
+    dispatcher->maxDepth};
+}
+
+OutboundQueue::Stats Mqtt::outboundStats() const {
+  std::lock_guard lock{p->outboundMutex};
+  return p->outbound ? p->outbound->stats() : OutboundQueue::Stats{};
+}
+
+void Mqtt::setResubscribePacing(std::size_t batchSize, std::chrono::milliseconds interval) {
+  p->setResubscribePacing(batchSize, interval);
+}
+
+Mqtt::ReconnectStats Mqtt::reconnectStats() const {
+  std::lock_guard lock{p->brokerMutex};
+  return p->reconnectStats;
+}
+
 }
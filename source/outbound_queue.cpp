@@ -0,0 +1,211 @@
+#include "essentials/outbound_queue.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace essentials {
+
+struct OutboundQueue::Private {
+  struct Header {
+    uint32_t dataSize;
+    uint16_t topicSize;
+    uint8_t qos;
+    uint8_t flags;
+  };
+  static constexpr uint8_t FLAG_RETAINED = 0x01;
+  static constexpr uint8_t FLAG_REMOVED = 0x02;
+
+  std::size_t capacity;
+  DropPolicy dropPolicy;
+  bool isCoalesced;
+  std::unique_ptr<char[]> memory;
+  // NOTE messages are stored in [begin, end), message at begin is never removed one
+  std::size_t begin = 0;
+  std::size_t end = 0;
+  std::size_t liveBytes = 0;
+  Stats stats{};
+
+  Private(std::size_t capacity, DropPolicy dropPolicy, bool isCoalesced) :
+    capacity(capacity), dropPolicy(dropPolicy), isCoalesced(isCoalesced), memory(std::make_unique<char[]>(capacity)) {
+  }
+
+  Header header(std::size_t offset) const {
+    Header header;
+    std::memcpy(&header, memory.get() + offset, sizeof(Header));
+    return header;
+  }
+
+  static std::size_t sizeOf(const Header& header) {
+    return sizeof(Header) + header.topicSize + header.dataSize;
+  }
+
+  std::string_view topicOf(std::size_t offset, const Header& header) const {
+    // NOTE stored topic is NUL-terminated but the terminator isn't part of the view
+    return std::string_view{memory.get() + offset + sizeof(Header), std::size_t(header.topicSize - 1)};
+  }
+
+  template<typename Callback>
+  std::size_t findLive(Callback&& predicate) const {
+    for (std::size_t offset = begin; offset < end; offset += sizeOf(header(offset))) {
+      Header entry = header(offset);
+      if (!(entry.flags & FLAG_REMOVED) && predicate(offset, entry)) return offset;
+    }
+    return end;
+  }
+
+  void remove(std::size_t offset) {
+    Header entry = header(offset);
+    entry.flags |= FLAG_REMOVED;
+    std::memcpy(memory.get() + offset, &entry, sizeof(Header));
+    liveBytes -= sizeOf(entry);
+    stats.depth--;
+
+    while (begin < end && (header(begin).flags & FLAG_REMOVED)) {
+      begin += sizeOf(header(begin));
+    }
+    if (begin == end) begin = end = 0;
+  }
+
+  void compact() {
+    std::size_t target = 0;
+    std::size_t offset = begin;
+    while (offset < end) {
+      const Header entry = header(offset);
+      const std::size_t size = sizeOf(entry);
+      if (!(entry.flags & FLAG_REMOVED)) {
+        std::memmove(memory.get() + target, memory.get() + offset, size);
+        target += size;
+      }
+      offset += size;
+    }
+    begin = 0;
+    end = target;
+  }
+
+  /**
+   * @brief Find message which is dropped to make space for a new message
+   */
+  std::size_t victim(int qos) const {
+    if (dropPolicy == DropPolicy::Oldest) return begin;
+    if (dropPolicy == DropPolicy::Newest) return end;
+
+    std::size_t victim = end;
+    int victimQos = qos + 1;
+    findLive([&victim, &victimQos](std::size_t offset, const Header& entry) {
+      if (entry.qos < victimQos) {
+        victim = offset;
+        victimQos = entry.qos;
+      }
+      return false;
+    });
+    return victim;
+  }
+
+  /**
+   * @brief Size of all messages which can be dropped for a new message, except the replaced one
+   */
+  std::size_t droppableBytes(int qos, std::size_t replaced) const {
+    if (dropPolicy == DropPolicy::Oldest) return liveBytes - (replaced == end ? 0 : sizeOf(header(replaced)));
+    if (dropPolicy == DropPolicy::Newest) return 0;
+
+    std::size_t bytes = 0;
+    findLive([qos, replaced, &bytes](std::size_t offset, const Header& entry) {
+      if (offset != replaced && entry.qos <= qos) bytes += sizeOf(entry);
+      return false;
+    });
+    return bytes;
+  }
+
+  bool push(std::string_view topic, std::string_view data, int qos, bool isRetained) {
+    const std::size_t size = sizeof(Header) + topic.size() + 1 + data.size();
+    if (size > capacity || topic.size() + 1 > UINT16_MAX) {
+      stats.dropped++;
+      return false;
+    }
+
+    std::size_t replaced = end;
+    if (isCoalesced) {
+      replaced = findLive([this, topic](std::size_t offset, const Header& entry) {
+        return topicOf(offset, entry) == topic;
+      });
+    }
+    const std::size_t replacedSize = replaced == end ? 0 : sizeOf(header(replaced));
+
+    // NOTE space of victims is counted before anything is removed so rejected message doesn't change the queue
+    const std::size_t freeSize = capacity - liveBytes + replacedSize;
+    if (freeSize < size && freeSize + droppableBytes(qos, replaced) < size) {
+      stats.dropped++;
+      return false;
+    }
+
+    if (replaced != end) {
+      remove(replaced);
+      stats.coalesced++;
+    }
+    while (capacity - liveBytes < size) {
+      const std::size_t dropped = victim(qos);
+      if (dropped == end) {
+        stats.dropped++;
+        return false;
+      }
+      remove(dropped);
+      stats.dropped++;
+    }
+    if (capacity - end < size) compact();
+
+    const uint8_t flags = isRetained ? FLAG_RETAINED : 0;
+    Header entry{uint32_t(data.size()), uint16_t(topic.size() + 1), uint8_t(qos), flags};
+    char* destination = memory.get() + end;
+    std::memcpy(destination, &entry, sizeof(Header));
+    std::memcpy(destination + sizeof(Header), topic.data(), topic.size());
+    destination[sizeof(Header) + topic.size()] = '\0';
+    std::memcpy(destination + sizeof(Header) + entry.topicSize, data.data(), data.size());
+    end += size;
+    liveBytes += size;
+    stats.depth++;
+    stats.enqueued++;
+    return true;
+  }
+};
+
+OutboundQueue::OutboundQueue(std::size_t capacity, DropPolicy dropPolicy, bool isCoalesced) :
+  p(std::make_unique<Private>(capacity, dropPolicy, isCoalesced)) {
+}
+
+OutboundQueue::~OutboundQueue() = default;
+
+bool OutboundQueue::push(std::string_view topic, std::string_view data, int qos, bool isRetained) {
+  return p->push(topic, data, qos, isRetained);
+}
+
+std::optional<OutboundQueue::Message> OutboundQueue::front() const {
+  if (p->begin == p->end) return std::nullopt;
+
+  const Private::Header entry = p->header(p->begin);
+  const char* data = p->memory.get() + p->begin + sizeof(Private::Header) + entry.topicSize;
+  return Message{p->topicOf(p->begin, entry),
+    std::string_view{data, entry.dataSize},
+    entry.qos,
+    bool(entry.flags & Private::FLAG_RETAINED)};
+}
+
+void OutboundQueue::pop() {
+  if (p->begin == p->end) {
+    throw std::runtime_error("outbound queue is empty");
+  }
+  p->remove(p->begin);
+  p->stats.sent++;
+}
+
+bool OutboundQueue::empty() const {
+  return p->begin == p->end;
+}
+
+OutboundQueue::Stats OutboundQueue::stats() const {
+  Stats stats = p->stats;
+  stats.bytes = p->liveBytes;
+  return stats;
+}
+
+}
@@ -0,0 +1,233 @@
+#include "essentials/payload_sink.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+
+namespace essentials {
+
+static constexpr std::size_t VERIFY_BUFFER_SIZE = 256;
+
+PartitionSink::PartitionSink(Partition& partition) : _partition(partition) {
+  if (_partition.size() < _partition.sectorSize() || _partition.sectorSize() < sizeof(Header)) {
+    throw std::runtime_error("partition is too small for payload");
+  }
+}
+
+std::size_t PartitionSink::capacity() const {
+  return _headerOffset();
+}
+
+void PartitionSink::begin(std::size_t size) {
+  _isWriting = false;
+  if (size > capacity()) {
+    throw std::runtime_error("payload doesn't fit into partition");
+  }
+  // NOTE erasing header sector invalidates committed payload before any of its data are overwritten
+  _partition.erase(_headerSector(), _partition.sectorSize());
+  _size = size;
+  _written = 0;
+  _erasedEnd = 0;
+  _isWriting = true;
+}
+
+void PartitionSink::write(Span<uint8_t> chunk) {
+  if (!_isWriting) {
+    throw std::runtime_error("payload wasn't started");
+  }
+  if (chunk.size > _size - _written) {
+    throw std::runtime_error("chunk exceeds payload size");
+  }
+
+  const std::size_t end = _written + chunk.size;
+  while (_erasedEnd < end) {
+    // NOTE header sector was erased by begin
+    if (_erasedEnd < _headerSector()) _partition.erase(_erasedEnd, _partition.sectorSize());
+    _erasedEnd += _partition.sectorSize();
+  }
+  _partition.write(_written, chunk);
+  _written = end;
+}
+
+void PartitionSink::commit(uint32_t crc) {
+  if (!_isWriting || _written != _size) {
+    throw std::runtime_error("payload is incomplete");
+  }
+  _isWriting = false;
+  if (_crcOf(_size) != crc) {
+    throw std::runtime_error("written payload doesn't match its CRC");
+  }
+
+  Header header{MAGIC, uint32_t(_size), crc, 0};
+  header.headerCrc = crc32(Span<uint8_t>{reinterpret_cast<const uint8_t*>(&header), offsetof(Header, headerCrc)});
+  _partition.write(_headerOffset(), Span<uint8_t>{reinterpret_cast<const uint8_t*>(&header), sizeof(header)});
+}
+
+void PartitionSink::abort() {
+  _isWriting = false;
+}
+
+std::optional<std::size_t> PartitionSink::verify() const {
+  Header header{};
+  _partition.read(_headerOffset(), MutableSpan<uint8_t>{reinterpret_cast<uint8_t*>(&header), sizeof(header)});
+  const uint32_t headerCrc =
+    crc32(Span<uint8_t>{reinterpret_cast<const uint8_t*>(&header), offsetof(Header, headerCrc)});
+  if (header.magic != MAGIC || header.headerCrc != headerCrc || header.size > capacity()) return std::nullopt;
+  if (_crcOf(header.size) != header.crc) return std::nullopt;
+  return header.size;
+}
+
+std::size_t PartitionSink::_headerOffset() const {
+  return _partition.size() - sizeof(Header);
+}
+
+std::size_t PartitionSink::_headerSector() const {
+  return _headerOffset() / _partition.sectorSize() * _partition.sectorSize();
+}
+
+uint32_t PartitionSink::_crcOf(std::size_t size) const {
+  std::array<uint8_t, VERIFY_BUFFER_SIZE> buffer{};
+  uint32_t crc = 0;
+  for (std::size_t offset = 0; offset < size; offset += buffer.size()) {
+    const std::size_t chunkSize = std::min(buffer.size(), size - offset);
+    _partition.read(offset, MutableSpan<uint8_t>{buffer.data(), chunkSize});
+    crc = crc32(Span<uint8_t>{buffer.data(), chunkSize}, crc);
+  }
+  return crc;
+}
+
+StorageSink::StorageSink(PersistentStorage& storage, std::string_view key, std::size_t chunkSize) :
+  _storage(storage),
+  _key(key.size() <= MAX_KEY_LENGTH ? StorageKey{key} : throw std::runtime_error("payload key is too long")),
+  _chunkSize(chunkSize) {
+  if (chunkSize == 0) {
+    throw std::runtime_error("chunk size must be positive");
+  }
+}
+
+void StorageSink::begin(std::size_t size) {
+  _isWriting = false;
+  if ((size + _chunkSize - 1) / _chunkSize > MAX_CHUNKS) {
+    throw std::runtime_error("payload has too many chunks");
+  }
+
+  std::optional<Manifest> manifest = _manifest();
+  _generation = manifest ? 1 - manifest->generation : 0;
+  _buffer.clear();
+  _buffer.reserve(_chunkSize);
+  _size = size;
+  _written = 0;
+  _isWriting = true;
+}
+
+void StorageSink::write(Span<uint8_t> chunk) {
+  if (!_isWriting) {
+    throw std::runtime_error("payload wasn't started");
+  }
+  if (chunk.size > _size - _written) {
+    throw std::runtime_error("chunk exceeds payload size");
+  }
+
+  while (chunk.size > 0) {
+    const std::size_t copied = std::min(chunk.size, _chunkSize - _buffer.size());
+    _buffer.insert(_buffer.end(), chunk.data, chunk.data + copied);
+    _written += copied;
+    chunk = Span<uint8_t>{chunk.data + copied, chunk.size - copied};
+    if (_buffer.size() == _chunkSize || _written == _size) _writeChunk();
+  }
+}
+
+void StorageSink::commit(uint32_t crc) {
+  if (!_isWriting || _written != _size) {
+    throw std::runtime_error("payload is incomplete");
+  }
+  _isWriting = false;
+
+  // NOTE chunks are read back so a payload which storage didn't keep intact is never committed
+  const std::size_t chunkCount = (_size + _chunkSize - 1) / _chunkSize;
+  _buffer.resize(_chunkSize);
+  uint32_t storedCrc = 0;
+  for (std::size_t i = 0; i < chunkCount; i++) {
+    const std::size_t expectedSize = std::min(_chunkSize, _size - i * _chunkSize);
+    const int storedSize =
+      _storage.readInto(_chunkKey(_generation, i), MutableSpan<uint8_t>{_buffer.data(), _chunkSize});
+    if (storedSize != int(expectedSize)) {
+      throw std::runtime_error("written payload is missing a chunk");
+    }
+    storedCrc = crc32(Span<uint8_t>{_buffer.data(), expectedSize}, storedCrc);
+  }
+  _buffer.clear();
+  if (storedCrc != crc) {
+    throw std::runtime_error("written payload doesn't match its CRC");
+  }
+
+  const Manifest manifest{MAGIC, uint32_t(_size), uint32_t(_chunkSize), crc, _generation};
+  _storage.write(_key, Span<uint8_t>{reinterpret_cast<const uint8_t*>(&manifest), sizeof(manifest)});
+  _storage.flush();
+}
+
+void StorageSink::abort() {
+  _isWriting = false;
+  _buffer.clear();
+}
+
+std::optional<std::size_t> StorageSink::verify() const {
+  std::optional<Manifest> manifest = _manifest();
+  if (!manifest || !read([](Span<uint8_t>) {})) return std::nullopt;
+  return manifest->size;
+}
+
+bool StorageSink::read(const std::function<void(Span<uint8_t>)>& consumer) const {
+  std::optional<Manifest> manifest = _manifest();
+  if (!manifest) return false;
+
+  std::vector<uint8_t> buffer(manifest->chunkSize);
+  uint32_t crc = 0;
+  for (std::size_t offset = 0, i = 0; offset < manifest->size; offset += manifest->chunkSize, i++) {
+    const std::size_t expectedSize = std::min<std::size_t>(manifest->chunkSize, manifest->size - offset);
+    const int storedSize =
+      _storage.readInto(_chunkKey(manifest->generation, i), MutableSpan<uint8_t>{buffer.data(), buffer.size()});
+    if (storedSize != int(expectedSize)) return false;
+
+    const Span<uint8_t> chunk{buffer.data(), expectedSize};
+    crc = crc32(chunk, crc);
+    consumer(chunk);
+  }
+  return crc == manifest->crc;
+}
+
+std::optional<StorageSink::Manifest> StorageSink::_manifest() const {
+  Manifest manifest{};
+  const int size =
+    _storage.readInto(_key, MutableSpan<uint8_t>{reinterpret_cast<uint8_t*>(&manifest), sizeof(manifest)});
+  if (size != int(sizeof(manifest)) || manifest.magic != MAGIC || manifest.chunkSize == 0 || manifest.generation > 1) {
+    return std::nullopt;
+  }
+  if ((std::size_t(manifest.size) + manifest.chunkSize - 1) / manifest.chunkSize > MAX_CHUNKS) return std::nullopt;
+  return manifest;
+}
+
+StorageKey StorageSink::_chunkKey(uint32_t generation, std::size_t index) const {
+  static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+  // key of chunk: [manifest key] [generation digit] [chunk index as 3 hex digits]
+  std::array<char, StorageKey::MAX_LENGTH> key{};
+  const std::string_view base = _key.view();
+  std::copy(base.begin(), base.end(), key.begin());
+  std::size_t size = base.size();
+  key[size++] = char('0' + generation);
+  key[size++] = HEX_DIGITS[(index >> 8) & 0xf];
+  key[size++] = HEX_DIGITS[(index >> 4) & 0xf];
+  key[size++] = HEX_DIGITS[index & 0xf];
+  return StorageKey{std::string_view{key.data(), size}};
+}
+
+void StorageSink::_writeChunk() {
+  const std::size_t index = (_written - 1) / _chunkSize;
+  _storage.write(_chunkKey(_generation, index), Span<uint8_t>{_buffer.data(), _buffer.size()});
+  // NOTE storages which stage writes would otherwise keep the whole payload in RAM
+  _storage.flush();
+  _buffer.clear();
+}
+
+}
@@ -0,0 +1,106 @@
+#include "essentials/periodic_task.hpp"
+
+#include "esp_log.h"
+#include "esp_pthread.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace essentials {
+
+const char* TAG_PERIODIC_TASK = "periodic_task";
+
+struct PeriodicTask::Private {
+  std::function<bool()> callback;
+  const char* name;
+  std::mutex mutex{};
+  std::condition_variable condition{};
+  std::chrono::milliseconds interval{};
+  std::chrono::steady_clock::time_point nextRun{};
+  // NOTE increased by every start() thus callback stops only the run it belongs to
+  uint32_t generation = 0;
+  bool isRunning = false;
+  bool isStopping = false;
+  std::thread thread{};
+
+  Private(std::function<bool()> callback, const char* name, std::size_t stackSize, int priority) :
+    callback(std::move(callback)), name(name) {
+    // NOTE pthread config applies to threads created by the calling task thus previous config is restored
+    esp_pthread_cfg_t previousConfig;
+    const bool hasPreviousConfig = esp_pthread_get_cfg(&previousConfig) == ESP_OK;
+    esp_pthread_cfg_t config = esp_pthread_get_default_config();
+    config.stack_size = stackSize;
+    config.prio = priority;
+    config.thread_name = name;
+    esp_pthread_set_cfg(&config);
+    thread = std::thread{[this]() { run(); }};
+    if (hasPreviousConfig) esp_pthread_set_cfg(&previousConfig);
+  }
+
+  ~Private() {
+    {
+      std::lock_guard lock{mutex};
+      isStopping = true;
+    }
+    condition.notify_one();
+    thread.join();
+  }
+
+  void run() {
+    std::unique_lock lock{mutex};
+    while (!isStopping) {
+      if (!isRunning) {
+        condition.wait(lock, [this]() { return isStopping || isRunning; });
+        continue;
+      }
+
+      const uint32_t runGeneration = generation;
+      const bool isChanged = condition.wait_until(lock, nextRun, [this, runGeneration]() {
+        return isStopping || !isRunning || generation != runGeneration;
+      });
+      if (isChanged) continue;
+
+      nextRun += interval;
+      lock.unlock();
+      bool isContinuing = true;
+      try {
+        isContinuing = callback();
+      } catch (const std::exception& e) {
+        ESP_LOGE(TAG_PERIODIC_TASK, "%s failed: %s", name, e.what());
+      }
+      lock.lock();
+      if (!isContinuing && generation == runGeneration) isRunning = false;
+      // NOTE callback which took longer than interval doesn't result in a burst of runs
+      nextRun = std::max(nextRun, std::chrono::steady_clock::now());
+    }
+  }
+};
+
+PeriodicTask::PeriodicTask(std::function<bool()> callback, const char* name, std::size_t stackSize, int priority) :
+  p(std::make_unique<Private>(std::move(callback), name, stackSize, priority)) {
+}
+
+PeriodicTask::~PeriodicTask() = default;
+
+void PeriodicTask::start(std::chrono::milliseconds interval) {
+  {
+    std::lock_guard lock{p->mutex};
+    p->interval = interval;
+    p->nextRun = std::chrono::steady_clock::now() + interval;
+    p->generation++;
+    p->isRunning = true;
+  }
+  p->condition.notify_one();
+}
+
+void PeriodicTask::stop() {
+  {
+    std::lock_guard lock{p->mutex};
+    p->isRunning = false;
+  }
+  p->condition.notify_one();
+}
+
+}
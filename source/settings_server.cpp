@@ -4,6 +4,7 @@
 #include "esp_http_server.h"
 #include "esp_log.h"
 
+#include <algorithm>
 #include <array>
 #include <optional>
 #include <string>
@@ -101,8 +102,48 @@ struct SettingsServer::Private {
   void setSettingsFromJson(std::string jsonContent) {
     cJSON* json = cJSON_Parse(jsonContent.c_str());
 
+    // NOTE fields of one storage are written in one transaction (configs on the same storage share it) thus they are
+    // never applied only partially. Transactions of different storages are committed one by one, when a later one
+    // fails the earlier ones stay committed.
+    std::vector<Config*> configs;
     for (auto& field : fields) {
-      field.value = cJSON_GetObjectItem(json, field.label.c_str())->valuestring;
+      Config* config = &field.value.config();
+      auto isSameStorage = [config](const Config* other) { return &other->storage() == &config->storage(); };
+      if (std::none_of(configs.begin(), configs.end(), isSameStorage)) configs.push_back(config);
+    }
+
+    std::size_t committed = 0;
+    std::size_t begun = 0;
+    bool isCommitting = false;
+    try {
+      for (; begun < configs.size(); begun++) {
+        configs[begun]->begin();
+      }
+      for (auto& field : fields) {
+        cJSON* item = cJSON_GetObjectItem(json, field.label.c_str());
+        if (!item || !item->valuestring) continue;
+        // NOTE only changed fields are written so config subscribers are notified about real changes
+        if (*field.value == item->valuestring) continue;
+        field.value = item->valuestring;
+      }
+      isCommitting = true;
+      for (; committed < configs.size(); committed++) {
+        configs[committed]->commit();
+      }
+    } catch (const std::exception& e) {
+      ESP_LOGE(TAG_SETTINGS_SERVER,
+        "Couldn't save settings: %s, settings of %u of %u storages were saved",
+        e.what(),
+        committed,
+        configs.size());
+      // NOTE config which failed to commit is already rolled back
+      for (std::size_t i = committed + (isCommitting ? 1 : 0); i < begun; i++) {
+        try {
+          configs[i]->rollback();
+        } catch (const std::exception& e) {
+          ESP_LOGE(TAG_SETTINGS_SERVER, "Couldn't rollback settings: %s", e.what());
+        }
+      }
     }
     cJSON_free(json);
   }
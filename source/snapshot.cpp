@@ -0,0 +1,165 @@
+#include "essentials/snapshot.hpp"
+
+#include "esp_log.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace essentials {
+
+const char* TAG_SNAPSHOT = "snapshot";
+
+static constexpr uint32_t SNAPSHOT_MAGIC = 0x4e534553; // "ESSN"
+static constexpr uint8_t SNAPSHOT_FORMAT_VERSION = 1;
+static constexpr uint8_t SNAPSHOT_FLAG_DELTA = 0x01;
+static constexpr std::size_t SNAPSHOT_HEADER_SIZE = 6;
+static constexpr std::size_t SNAPSHOT_CRC_SIZE = 4;
+
+static void appendVarint(std::vector<uint8_t>& output, uint32_t value) {
+  while (value >= 0x80) {
+    output.push_back(uint8_t(value) | 0x80);
+    value >>= 7;
+  }
+  output.push_back(value);
+}
+
+static void appendU32(std::vector<uint8_t>& output, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    output.push_back(value >> (8 * i));
+  }
+}
+
+static uint32_t readU32(const uint8_t* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) | (uint32_t(data[3]) << 24);
+}
+
+struct SnapshotReader {
+  Span<uint8_t> snapshot;
+  std::size_t position = 0;
+
+  uint32_t varint() {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 32; shift += 7) {
+      const uint8_t byte = bytes(1).data[0];
+      value |= uint32_t(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) return value;
+    }
+    throw std::runtime_error("malformed snapshot size");
+  }
+
+  Span<uint8_t> bytes(std::size_t size) {
+    if (snapshot.size - position < size) {
+      throw std::runtime_error("truncated snapshot");
+    }
+    Span<uint8_t> data{snapshot.data + position, size};
+    position += size;
+    return data;
+  }
+};
+
+/**
+ * @brief Validate snapshot and return its entries pointing into the snapshot
+ */
+static std::vector<PersistentStorage::Entry> parseSnapshot(Span<uint8_t> snapshot) {
+  if (snapshot.size < SNAPSHOT_HEADER_SIZE + SNAPSHOT_CRC_SIZE) {
+    throw std::runtime_error("snapshot is too small");
+  }
+  const std::size_t crcOffset = snapshot.size - SNAPSHOT_CRC_SIZE;
+  if (readU32(snapshot.data + crcOffset) != crc32(Span<uint8_t>{snapshot.data, crcOffset})) {
+    throw std::runtime_error("snapshot checksum mismatch");
+  }
+  if (readU32(snapshot.data) != SNAPSHOT_MAGIC) {
+    throw std::runtime_error("data aren't a snapshot");
+  }
+  if (snapshot.data[4] != SNAPSHOT_FORMAT_VERSION) {
+    throw std::runtime_error("unsupported snapshot version");
+  }
+
+  SnapshotReader reader{Span<uint8_t>{snapshot.data, crcOffset}, SNAPSHOT_HEADER_SIZE};
+  const uint32_t count = reader.varint();
+  std::vector<PersistentStorage::Entry> entries;
+  entries.reserve(std::min<std::size_t>(count, crcOffset));
+  for (uint32_t i = 0; i < count; i++) {
+    const uint8_t keySize = reader.bytes(1).data[0];
+    if (keySize == 0) {
+      throw std::runtime_error("snapshot contains empty key");
+    }
+    Span<uint8_t> key = reader.bytes(keySize);
+    Span<uint8_t> data = reader.bytes(reader.varint());
+    entries.push_back(
+      PersistentStorage::Entry{StorageKey{std::string_view{reinterpret_cast<const char*>(key.data), key.size}}, data});
+  }
+  if (reader.position != crcOffset) {
+    throw std::runtime_error("unexpected data at the end of snapshot");
+  }
+  return entries;
+}
+
+static std::vector<uint8_t> exportSnapshot(
+  const PersistentStorage& storage, const std::vector<PersistentStorage::Entry>* base) {
+  std::vector<uint8_t> snapshot;
+  appendU32(snapshot, SNAPSHOT_MAGIC);
+  snapshot.push_back(SNAPSHOT_FORMAT_VERSION);
+  snapshot.push_back(base ? SNAPSHOT_FLAG_DELTA : 0);
+
+  std::vector<uint8_t> body;
+  uint32_t count = 0;
+  std::vector<uint8_t> data;
+  for (const StorageKey& key : storage.keys()) {
+    int size = storage.readInto(key, MutableSpan<uint8_t>{data.data(), data.size()});
+    if (size > int(data.size())) {
+      data.resize(size);
+      size = storage.readInto(key, MutableSpan<uint8_t>{data.data(), data.size()});
+    }
+    if (size < 0) continue;
+
+    if (base) {
+      auto it = std::find_if(base->begin(), base->end(), [&key](const auto& entry) { return entry.key == key; });
+      if (it != base->end() && it->data.size == std::size_t(size) &&
+        std::equal(data.begin(), data.begin() + size, it->data.data)) {
+        continue;
+      }
+    }
+
+    body.push_back(key.view().size());
+    body.insert(body.end(), key.view().begin(), key.view().end());
+    appendVarint(body, size);
+    body.insert(body.end(), data.begin(), data.begin() + size);
+    count++;
+  }
+
+  appendVarint(snapshot, count);
+  snapshot.insert(snapshot.end(), body.begin(), body.end());
+  appendU32(snapshot, crc32(Span<uint8_t>{snapshot.data(), snapshot.size()}));
+  return snapshot;
+}
+
+std::vector<uint8_t> exportSnapshot(const PersistentStorage& storage) {
+  return exportSnapshot(storage, nullptr);
+}
+
+std::vector<uint8_t> exportSnapshot(const PersistentStorage& storage, Span<uint8_t> base) {
+  std::vector<PersistentStorage::Entry> baseEntries = parseSnapshot(base);
+  return exportSnapshot(storage, &baseEntries);
+}
+
+std::size_t importSnapshot(PersistentStorage& storage, Span<uint8_t> snapshot) {
+  std::vector<PersistentStorage::Entry> entries = parseSnapshot(snapshot);
+  if (entries.empty()) return 0;
+
+  storage.begin();
+  try {
+    storage.writeBatch(Span<PersistentStorage::Entry>{entries.data(), entries.size()});
+    storage.commit();
+  } catch (...) {
+    try {
+      storage.rollback();
+    } catch (const std::exception& e) {
+      ESP_LOGE(TAG_SNAPSHOT, "couldn't rollback snapshot import: %s", e.what());
+    }
+    throw;
+  }
+  return entries.size();
+}
+
+}
@@ -0,0 +1,268 @@
+#include "essentials/telemetry.hpp"
+
+#include "essentials/float_conversion.hpp"
+#include "essentials/periodic_task.hpp"
+
+#include "esp_log.h"
+
+#include <array>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+namespace essentials {
+
+const char* TAG_TELEMETRY = "telemetry";
+
+struct Telemetry::Private {
+  struct Metric {
+    Value value;
+    bool isUpdated;
+    std::function<Value()> sampler;
+    std::optional<Mqtt::Topic> topic;
+  };
+
+  // NOTE upper bound of encoded value used for size threshold
+  static constexpr std::size_t MAX_VALUE_SIZE = 32;
+
+  Mqtt& mqtt;
+  Mqtt::Topic topic;
+  std::string topicName;
+  Format format;
+  std::size_t maxPayloadSize;
+  bool isPublishedPerMetric;
+  mutable std::mutex mutex{};
+  std::map<std::string, Metric, std::less<>> metrics{};
+  std::size_t pendingSize = 0;
+  std::string payload{};
+  Stats stats{};
+  // NOTE samplers and publishing can block, thus they don't run on the shared esp_timer task
+  PeriodicTask intervalTask{[this]() { return onInterval(); }, TAG_TELEMETRY};
+
+  Private(Mqtt& mqtt,
+    std::string_view topic,
+    std::chrono::milliseconds interval,
+    Format format,
+    std::size_t maxPayloadSize,
+    bool isPublishedPerMetric) :
+    mqtt(mqtt),
+    topic(mqtt.topic(topic)),
+    topicName(topic),
+    format(format),
+    maxPayloadSize(maxPayloadSize),
+    isPublishedPerMetric(isPublishedPerMetric) {
+    payload.reserve(maxPayloadSize);
+    intervalTask.start(interval);
+  }
+
+  bool onInterval() {
+    try {
+      std::lock_guard lock{mutex};
+      flush();
+    } catch (const std::exception& e) {
+      ESP_LOGE(TAG_TELEMETRY, "couldn't publish telemetry: %s", e.what());
+    }
+    return true;
+  }
+
+  Metric& metric(std::string_view name) {
+    auto it = metrics.find(name);
+    if (it == metrics.end()) {
+      it = metrics.emplace(std::string(name), Metric{Value{}, false, nullptr, std::nullopt}).first;
+      if (isPublishedPerMetric) it->second.topic = mqtt.topic(topicName + "/" + it->first);
+    }
+    return it->second;
+  }
+
+  void set(std::string_view name, Value value) {
+    Metric& metric = this->metric(name);
+    metric.value = value;
+    if (metric.isUpdated) return;
+
+    metric.isUpdated = true;
+    pendingSize += name.size() + MAX_VALUE_SIZE;
+    if (pendingSize >= maxPayloadSize) flush();
+  }
+
+  void flush() {
+    for (auto& [name, metric] : metrics) {
+      if (!metric.sampler) continue;
+      metric.value = metric.sampler();
+      metric.isUpdated = true;
+    }
+
+    std::size_t count = 0;
+    payload.clear();
+    for (auto& [name, metric] : metrics) {
+      if (!metric.isUpdated) continue;
+      metric.isUpdated = false;
+
+      const std::size_t sizeBefore = payload.size();
+      appendEntry(name, metric.value);
+      if (payload.size() + headerSize(count + 1) > maxPayloadSize && count > 0) {
+        // NOTE entry doesn't fit, previous entries are published and entry starts a new message
+        std::string entry = payload.substr(sizeBefore);
+        payload.resize(sizeBefore);
+        publish(count);
+        payload = entry;
+        count = 0;
+      }
+      count++;
+
+      if (metric.topic) {
+        std::array<char, 32> text;
+        mqtt.publish(*metric.topic, formatText(metric.value, text), Mqtt::Qos::Qos0, false);
+      }
+    }
+    if (count > 0) publish(count);
+    pendingSize = 0;
+  }
+
+  /**
+   * @brief Bytes which publish adds to entries of a message, JSON's '{' or MessagePack's map header
+   */
+  std::size_t headerSize(std::size_t count) const {
+    if (format == Format::Json) return 1;
+    return count < 16 ? 1 : 3;
+  }
+
+  void publish(std::size_t count) {
+    if (format == Format::Json) {
+      payload.insert(payload.begin(), '{');
+      payload.back() = '}';
+    } else {
+      std::array<uint8_t, 3> header;
+      std::size_t headerSize = 1;
+      if (count < 16) {
+        header[0] = 0x80 | count;
+      } else {
+        header[0] = 0xde;
+        header[1] = count >> 8;
+        header[2] = count;
+        headerSize = 3;
+      }
+      payload.insert(payload.begin(), header.begin(), header.begin() + headerSize);
+    }
+
+    mqtt.publish(topic, payload, Mqtt::Qos::Qos0, false);
+    stats.messages++;
+    stats.values += count;
+    stats.bytes += payload.size();
+    payload.clear();
+  }
+
+  /**
+   * @brief Append name and value, JSON entries end with ',' which is replaced by '}' when message is complete
+   */
+  void appendEntry(std::string_view name, const Value& value) {
+    if (format == Format::Json) {
+      payload += '"';
+      payload += name;
+      payload += "\":";
+      if (const bool* boolean = std::get_if<bool>(&value)) {
+        payload += *boolean ? "true" : "false";
+      } else if (const double* number = std::get_if<double>(&value); number && !std::isfinite(*number)) {
+        payload += "null";
+      } else {
+        std::array<char, 32> text;
+        payload += formatText(value, text);
+      }
+      payload += ',';
+      return;
+    }
+
+    if (name.size() < 32) {
+      payload += char(0xa0 | name.size());
+    } else {
+      payload += char(0xd9);
+      payload += char(std::min<std::size_t>(name.size(), 255));
+    }
+    payload.append(name.substr(0, 255));
+
+    if (const bool* boolean = std::get_if<bool>(&value)) {
+      payload += char(*boolean ? 0xc3 : 0xc2);
+    } else if (const int64_t* integer = std::get_if<int64_t>(&value)) {
+      if (*integer >= -32 && *integer < 128) {
+        // NOTE positive and negative fixint
+        payload += char(*integer);
+      } else if (*integer >= INT32_MIN && *integer <= INT32_MAX) {
+        appendBigEndian(0xd2, uint32_t(*integer), 4);
+      } else {
+        appendBigEndian(0xd3, uint64_t(*integer), 8);
+      }
+    } else {
+      const double number = std::get<double>(value);
+      const float narrowed = number;
+      if (double(narrowed) == number || std::isnan(number)) {
+        uint32_t bits;
+        std::memcpy(&bits, &narrowed, sizeof(bits));
+        appendBigEndian(0xca, bits, 4);
+      } else {
+        uint64_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        appendBigEndian(0xcb, bits, 8);
+      }
+    }
+  }
+
+  void appendBigEndian(uint8_t type, uint64_t value, int size) {
+    payload += char(type);
+    for (int i = size - 1; i >= 0; i--) {
+      payload += char(value >> (8 * i));
+    }
+  }
+
+  static std::string_view formatText(const Value& value, std::array<char, 32>& buffer) {
+    if (const bool* boolean = std::get_if<bool>(&value)) return *boolean ? Mqtt::TRUE_LITERAL : Mqtt::FALSE_LITERAL;
+
+    int size = 0;
+    if (const int64_t* integer = std::get_if<int64_t>(&value)) {
+      size = std::snprintf(buffer.data(), buffer.size(), "%" PRId64, *integer);
+    } else {
+      const double number = std::get<double>(value);
+      if (std::isnan(number)) return Mqtt::NAN_LITERAL;
+      if (std::isinf(number)) return number > 0 ? Mqtt::POSITIVE_INF_LITERAL : Mqtt::NEGATIVE_INF_LITERAL;
+      size = int(formatFloat(number, MutableSpan<char>{buffer.data(), buffer.size()}));
+    }
+    return std::string_view{buffer.data(), std::size_t(std::max(size, 0))};
+  }
+};
+
+Telemetry::Telemetry(Mqtt& mqtt,
+  std::string_view topic,
+  std::chrono::milliseconds interval,
+  Format format,
+  std::size_t maxPayloadSize,
+  bool isPublishedPerMetric) :
+  p(std::make_unique<Private>(mqtt, topic, interval, format, maxPayloadSize, isPublishedPerMetric)) {
+}
+
+Telemetry::~Telemetry() = default;
+
+void Telemetry::flush() {
+  std::lock_guard lock{p->mutex};
+  p->flush();
+}
+
+Telemetry::Stats Telemetry::stats() const {
+  std::lock_guard lock{p->mutex};
+  return p->stats;
+}
+
+void Telemetry::_set(std::string_view name, Value value) {
+  std::lock_guard lock{p->mutex};
+  p->set(name, value);
+}
+
+void Telemetry::_sample(std::string_view name, std::function<Value()> sampler) {
+  std::lock_guard lock{p->mutex};
+  p->metric(name).sampler = std::move(sampler);
+}
+
+}
@@ -0,0 +1,284 @@
+#include "essentials/wear_managed_storage.hpp"
+
+#include "essentials/periodic_task.hpp"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace essentials {
+
+const char* TAG_WEAR_MANAGED_STORAGE = "wear_managed_storage";
+
+struct WearManagedStorage::Private {
+  PersistentStorage& storage;
+  Budget budget;
+  mutable std::mutex mutex{};
+  std::unordered_map<StorageKey, std::vector<uint8_t>, StorageKey::Hash> deferred{};
+  std::unordered_map<StorageKey, KeyStats, StorageKey::Hash> keyStats{};
+  Stats stats{};
+  double tokens;
+  int64_t refilledAt;
+  bool isInTransaction = false;
+  std::vector<uint8_t> stored{};
+  // NOTE flash writes of deferred data don't run on the shared esp_timer task, the task is the last member thus it
+  // stops before the deferred data it writes are destroyed
+  PeriodicTask budgetTask{[this]() { return onBudget(); }, TAG_WEAR_MANAGED_STORAGE};
+
+  Private(PersistentStorage& storage, Budget budget) :
+    storage(storage), budget(budget), tokens(budget.writes), refilledAt(esp_timer_get_time()) {
+    if (budget.writes == 0 || budget.period.count() <= 0) {
+      throw std::runtime_error("write budget must allow some writes");
+    }
+  }
+
+  ~Private() {
+    budgetTask.stop();
+    try {
+      std::lock_guard lock{mutex};
+      writeDeferred();
+    } catch (const std::exception& e) {
+      ESP_LOGE(TAG_WEAR_MANAGED_STORAGE, "couldn't write deferred data: %s", e.what());
+    }
+  }
+
+  bool onBudget() {
+    std::lock_guard lock{mutex};
+    try {
+      if (consumeBudget()) {
+        writeDeferred();
+      } else {
+        scheduleDeferred();
+      }
+    } catch (const std::exception& e) {
+      ESP_LOGE(TAG_WEAR_MANAGED_STORAGE, "couldn't write deferred data: %s", e.what());
+      // NOTE data stay deferred and later writes don't schedule them, thus they are retried after time of one write
+      const int64_t delay = 1 / writesPerMicrosecond() + 1;
+      budgetTask.start(std::chrono::ceil<std::chrono::milliseconds>(std::chrono::microseconds{delay}));
+    }
+    return false;
+  }
+
+  double writesPerMicrosecond() const {
+    return double(budget.writes) / std::chrono::microseconds{budget.period}.count();
+  }
+
+  bool consumeBudget() {
+    const int64_t now = esp_timer_get_time();
+    tokens = std::min(double(budget.writes), tokens + (now - refilledAt) * writesPerMicrosecond());
+    refilledAt = now;
+    if (tokens < 1) return false;
+    tokens -= 1;
+    return true;
+  }
+
+  void scheduleDeferred() {
+    const int64_t delay = (1 - tokens) / writesPerMicrosecond() + 1;
+    budgetTask.start(std::chrono::ceil<std::chrono::milliseconds>(std::chrono::microseconds{delay}));
+  }
+
+  const std::vector<uint8_t>* findDeferred(const StorageKey& key) const {
+    auto it = deferred.find(key);
+    if (it == deferred.end()) return nullptr;
+    return &it->second;
+  }
+
+  bool isStored(const StorageKey& key, Span<uint8_t> data) {
+    if (const auto* deferredData = findDeferred(key)) {
+      return deferredData->size() == data.size && std::equal(data.data, data.data + data.size, deferredData->begin());
+    }
+
+    // NOTE buffer is one byte bigger so stored data longer than new data are recognized without second read
+    stored.resize(data.size + 1);
+    const int size = storage.readInto(key, MutableSpan<uint8_t>{stored.data(), stored.size()});
+    return size == int(data.size) && std::equal(data.data, data.data + data.size, stored.begin());
+  }
+
+  void written(const StorageKey& key) {
+    KeyStats& stats = keyStatsOf(key);
+    stats.writes++;
+    this->stats.writes++;
+  }
+
+  KeyStats& keyStatsOf(const StorageKey& key) {
+    return keyStats.try_emplace(key, KeyStats{key, 0, 0, 0}).first->second;
+  }
+
+  /**
+   * @brief Write entries which aren't stored yet, defer them when budget is exhausted
+   */
+  void write(Span<Entry> entries) {
+    std::vector<Entry> changed;
+    changed.reserve(entries.size);
+    for (std::size_t i = 0; i < entries.size; i++) {
+      const Entry& entry = entries.data[i];
+      if (isStored(entry.key, entry.data)) {
+        keyStatsOf(entry.key).skipped++;
+        stats.skipped++;
+      } else {
+        changed.push_back(entry);
+      }
+    }
+    if (changed.empty()) return;
+
+    if (!isInTransaction && (!deferred.empty() || !consumeBudget())) {
+      const bool isScheduled = !deferred.empty();
+      for (const Entry& entry : changed) {
+        auto [it, isInserted] = deferred.try_emplace(entry.key);
+        if (!isInserted) {
+          keyStatsOf(entry.key).coalesced++;
+          stats.coalesced++;
+        }
+        it->second.assign(entry.data.data, entry.data.data + entry.data.size);
+      }
+      if (!isScheduled) scheduleDeferred();
+      return;
+    }
+
+    storage.writeBatch(Span<Entry>{changed.data(), changed.size()});
+    for (const Entry& entry : changed) {
+      written(entry.key);
+    }
+  }
+
+  void writeDeferred() {
+    if (deferred.empty()) return;
+
+    budgetTask.stop();
+    std::vector<Entry> entries;
+    entries.reserve(deferred.size());
+    for (const auto& [key, data] : deferred) {
+      entries.push_back(Entry{key, Span<uint8_t>{data.data(), data.size()}});
+    }
+    storage.writeBatch(Span<Entry>{entries.data(), entries.size()});
+    for (const Entry& entry : entries) {
+      written(entry.key);
+    }
+    deferred.clear();
+  }
+};
+
+WearManagedStorage::WearManagedStorage(PersistentStorage& storage, Budget budget) :
+  p(std::make_unique<Private>(storage, budget)) {
+}
+
+WearManagedStorage::~WearManagedStorage() = default;
+
+int WearManagedStorage::size(const StorageKey& key) const {
+  {
+    std::lock_guard lock{p->mutex};
+    if (const auto* data = p->findDeferred(key)) return data->size();
+  }
+  return p->storage.size(key);
+}
+
+std::vector<uint8_t> WearManagedStorage::read(const StorageKey& key, int size) const {
+  {
+    std::lock_guard lock{p->mutex};
+    if (const auto* data = p->findDeferred(key)) {
+      if (int(data->size()) > size) {
+        throw std::runtime_error("deferred data is bigger than requested size");
+      }
+      std::vector<uint8_t> buffer = *data;
+      buffer.resize(size);
+      return buffer;
+    }
+  }
+  return p->storage.read(key, size);
+}
+
+int WearManagedStorage::readInto(const StorageKey& key, MutableSpan<uint8_t> buffer) const {
+  {
+    std::lock_guard lock{p->mutex};
+    if (const auto* data = p->findDeferred(key)) {
+      if (data->size() <= buffer.size) {
+        std::copy(data->begin(), data->end(), buffer.data);
+      }
+      return data->size();
+    }
+  }
+  return p->storage.readInto(key, buffer);
+}
+
+void WearManagedStorage::write(const StorageKey& key, Span<uint8_t> data) {
+  Entry entry{key, data};
+  writeBatch(Span<Entry>{&entry, 1});
+}
+
+void WearManagedStorage::writeBatch(Span<Entry> entries) {
+  std::lock_guard lock{p->mutex};
+  p->write(entries);
+}
+
+void WearManagedStorage::clear() {
+  {
+    std::lock_guard lock{p->mutex};
+    p->budgetTask.stop();
+    p->deferred.clear();
+  }
+  p->storage.clear();
+}
+
+std::vector<StorageKey> WearManagedStorage::keys() const {
+  std::vector<StorageKey> keys = p->storage.keys();
+  std::lock_guard lock{p->mutex};
+  for (const auto& [key, data] : p->deferred) {
+    if (std::find(keys.begin(), keys.end(), key) == keys.end()) keys.push_back(key);
+  }
+  return keys;
+}
+
+void WearManagedStorage::flush() {
+  {
+    std::lock_guard lock{p->mutex};
+    p->writeDeferred();
+  }
+  p->storage.flush();
+}
+
+void WearManagedStorage::begin() {
+  std::lock_guard lock{p->mutex};
+  // NOTE deferred data are written first so transaction is applied on top of them
+  p->writeDeferred();
+  p->storage.begin();
+  p->isInTransaction = true;
+}
+
+void WearManagedStorage::commit() {
+  std::lock_guard lock{p->mutex};
+  p->isInTransaction = false;
+  p->consumeBudget();
+  p->storage.commit();
+}
+
+void WearManagedStorage::rollback() {
+  std::lock_guard lock{p->mutex};
+  p->isInTransaction = false;
+  p->storage.rollback();
+}
+
+WearManagedStorage::Stats WearManagedStorage::stats() const {
+  std::lock_guard lock{p->mutex};
+  Stats stats = p->stats;
+  stats.deferred = p->deferred.size();
+  return stats;
+}
+
+std::vector<WearManagedStorage::KeyStats> WearManagedStorage::keyStats() const {
+  std::vector<KeyStats> keyStats;
+  {
+    std::lock_guard lock{p->mutex};
+    keyStats.reserve(p->keyStats.size());
+    for (const auto& [key, stats] : p->keyStats) {
+      keyStats.push_back(stats);
+    }
+  }
+  std::sort(keyStats.begin(), keyStats.end(), [](const KeyStats& a, const KeyStats& b) { return a.writes > b.writes; });
+  return keyStats;
+}
+
+}